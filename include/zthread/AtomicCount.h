@@ -43,7 +43,11 @@ namespace ZThread {
    */
   class ZTHREAD_API AtomicCount : public NonCopyable {
   
-    void* _value;
+    //! Implementation state, or the count itself where the implementation keeps it in place
+    union {
+      void* _value;
+      size_t _count;
+    };
   
   public:
   
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTCANCELLATIONTOKEN_H__
+#define __ZTCANCELLATIONTOKEN_H__
+
+#include "zthread/Cancelable.h"
+#include "zthread/CountedPtr.h"
+
+namespace ZThread {
+
+  class TokenImpl;
+
+  /**
+   * @class CancellationToken
+   * @version 2.3.3
+   *
+   * A CancellationToken lets a set of tasks, one request's worth for instance,
+   * be canceled without disturbing the other tasks an executor is running.
+   * Copies of a token share its state; the tasks submitted to a PoolExecutor 
+   * with the same token are canceled together.
+   *
+   * - Tasks still queued when the token is canceled are dropped without being 
+   *   run.
+   * - Threads running a task submitted with the token are interrupt()ed. Other
+   *   threads of the executor are left alone.
+   *
+   * A task can also poll the token itself; isCanceled() is a single atomic load.
+   *
+   * @code
+   *
+   * CancellationToken request;
+   *
+   * executor.execute(new Lookup(query), request);
+   * executor.execute(new Render(query), request);
+   *
+   * // The client went away
+   * request.cancel();
+   *
+   * @endcode
+   *
+   * @see PoolExecutor::execute(const Task&, const CancellationToken&)
+   */
+  class ZTHREAD_API CancellationToken : public Cancelable {
+
+    friend class PoolExecutor;
+
+    CountedPtr< TokenImpl > _impl;
+
+  public:
+
+    //! Create a token that has not been canceled
+    CancellationToken();
+
+    //! Create a token that shares the state of another
+    CancellationToken(const CancellationToken& token);
+
+    //! Share the state of another token
+    CancellationToken& operator=(const CancellationToken& token);
+
+    virtual ~CancellationToken();
+
+    /**
+     * Cancel the tasks submitted with this token, dropping those not yet 
+     * started and interrupting the threads running the others.
+     *
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+
+  }; /* CancellationToken */
+
+} // namespace ZThread
+
+#endif // __ZTCANCELLATIONTOKEN_H__
@@ -96,6 +96,33 @@ namespace ZThread {
      * @see Executor::execute(const Task&)
      */
     virtual void execute(const Task&);
+
+    /**
+     * Submit a batch of Tasks to this Executor, holding the queue's lock once. 
+     * The batch is counted as a single group of tasks for the purposes of wait().
+     *
+     * @param tasks first of the Tasks to submit
+     * @param n number of Tasks
+     *
+     * @exception Cancellation_Exception thrown if this Executor has been canceled;
+     * no Task in the batch will be executed by this Executor.
+     *
+     * @see PoolExecutor::executeBatch(const Task* tasks, size_t n)
+     */
+    void executeBatch(const Task* tasks, size_t n);
+
+    /**
+     * Submit a range of Tasks to this Executor as a single batch.
+     *
+     * @param begin first of the tasks to submit, Tasks or Runnable pointers
+     * @param end position after the last task
+     *
+     * @see PoolExecutor::executeAll(InputIterator begin, InputIterator end)
+     */
+    template <class InputIterator>
+    void executeAll(InputIterator begin, InputIterator end) {
+      _executor.executeAll(begin, end);
+    }
     
     /**
      * @see Cancelable::cancel()
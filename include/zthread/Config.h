@@ -37,6 +37,10 @@
 // Uncomment to disable compiling the interrupt() hook mechanisms.
 // #define ZTHREAD_DISABLE_INTERRUPT 1
 
+// (configure)
+// Uncomment to disable collecting PoolExecutor metrics
+// #define ZTHREAD_DISABLE_METRICS 1
+
 // (configure)
 // Uncomment to select a Win32 ThreadOps implementation that uses _beginthreadex()
 // otherwise, CreateThread() will be used for a Windows compilation
@@ -69,7 +73,8 @@
 // Eventually, the configure program will be updated to define these symbols as well.
 // =====================================================================================
 
-// Uncomment to select very simple spinlock based implementations
+// Uncomment to select spinlock based implementations. On POSIX systems this is a ticket
+// lock, which needs configure to find the compiler's atomic builtins (--enable-atomic-gcc)
 // #define ZTHREAD_USE_SPIN_LOCKS 1
 
 // Uncomment to select the vannila dual mutex implementation of FastRecursiveLock
@@ -79,9 +84,22 @@
 // spin, but instead sleeps on a condition variable.
 // #define ZTHREAD_CONDITION_LOCKS 1
 
+// (configure)
+// Uncomment to make threads finding a Mutex, FastMutex or internal lock held block 
+// at once, rather than spin for a while that adapts to how long the lock is held
+// #define ZTHREAD_DISABLE_ADAPTIVE_SPIN 1
+
+// Uncomment to let running threads take a released Mutex ahead of the waiting thread
+// that was woken for it, until a waiter has been kept waiting too long.
+// #define ZTHREAD_MUTEX_BARGING 1
+
 // Uncomment if you want to eliminate inlined code used as a part of some template classes
 // #define ZTHREAD_NOINLINE
 
+// Uncomment to leave out the coroutine awaitables, which are otherwise available
+// to clients compiled as C++20
+// #define ZTHREAD_DISABLE_COROUTINES 1
+
 // Uncomment if you want to compile a DLL version of the library. (Win32)
 // #define ZTHREAD_EXPORTS 1
 
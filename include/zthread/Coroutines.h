@@ -0,0 +1,766 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTCOROUTINES_H__
+#define __ZTCOROUTINES_H__
+
+#include "zthread/Config.h"
+
+// Coroutine support is only compiled for clients built as C++20 or later; the
+// library itself does not depend on it
+#if !defined(ZTHREAD_DISABLE_COROUTINES) && \
+    defined(__cpp_impl_coroutine) && (__cpp_impl_coroutine >= 201902L)
+#  define ZTHREAD_COROUTINES 1
+#endif
+
+#if defined(ZTHREAD_COROUTINES)
+
+#include "zthread/Exceptions.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/NonCopyable.h"
+#include "zthread/PoolExecutor.h"
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+#include <utility>
+
+namespace ZThread {
+
+  /**
+   * @class AsyncWaiter
+   * @version 2.3.3
+   *
+   * A suspended coroutine, linked into the list of waiters of one of the 
+   * asynchronous primitives. The waiter is part of the awaiter, which lives in
+   * the coroutine's frame, so waiting does not allocate. Once a waiter has 
+   * been handed to resume() the coroutine may run, and destroy it, at any time.
+   */
+  class AsyncWaiter {
+  public:
+
+    AsyncWaiter* next;
+
+    std::coroutine_handle<> handle;
+
+    //! Executor the coroutine is resumed on
+    PoolExecutor* executor;
+
+    explicit AsyncWaiter(PoolExecutor& e) : next(nullptr), executor(&e) { }
+
+    /**
+     * Queue the coroutine to be resumed by the executor. If the executor has 
+     * been canceled it is resumed by the calling thread instead, so that it 
+     * is not lost.
+     */
+    void resume() {
+
+      std::coroutine_handle<> h = handle;
+
+      try {
+        executor->execute(&AsyncWaiter::run, h.address());
+      } catch(Synchronization_Exception&) {
+        h.resume();
+      }
+
+    }
+
+    //! Resume the coroutine whose handle is given, passed to PoolExecutor::execute()
+    static void run(void* address) {
+      std::coroutine_handle<>::from_address(address).resume();
+    }
+
+  }; /* AsyncWaiter */
+
+  /**
+   * @class AsyncWaiterList
+   * @version 2.3.3
+   *
+   * FIFO list of AsyncWaiters, serialized by the primitive that owns it.
+   */
+  class AsyncWaiterList {
+
+    AsyncWaiter* _head;
+    AsyncWaiter* _tail;
+
+  public:
+
+    AsyncWaiterList() : _head(nullptr), _tail(nullptr) { }
+
+    bool empty() const {
+      return _head == nullptr;
+    }
+
+    void push(AsyncWaiter* w) {
+
+      w->next = nullptr;
+
+      if(_tail)
+        _tail->next = w;
+      else
+        _head = w;
+
+      _tail = w;
+
+    }
+
+    //! @return the first waiter, or 0 if there is none
+    AsyncWaiter* pop() {
+
+      AsyncWaiter* w = _head;
+
+      if(w) {
+
+        _head = w->next;
+
+        if(!_head)
+          _tail = nullptr;
+
+      }
+
+      return w;
+
+    }
+
+  }; /* AsyncWaiterList */
+
+  /**
+   * @class ScheduleAwaiter
+   * @version 2.3.3
+   *
+   * Awaiting a ScheduleAwaiter moves the coroutine onto a thread of a 
+   * PoolExecutor. The continuation is queued as a plain function, so 
+   * scheduling does not allocate.
+   *
+   * @code
+   *
+   * co_await schedule(executor);
+   * // Now running on a thread of the executor
+   *
+   * @endcode
+   *
+   * @exception Cancellation_Exception thrown by co_await if the executor has 
+   *            been canceled; the coroutine continues on the same thread.
+   */
+  class ScheduleAwaiter {
+
+    PoolExecutor& _executor;
+
+  public:
+
+    explicit ScheduleAwaiter(PoolExecutor& executor) : _executor(executor) { }
+
+    bool await_ready() const noexcept {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+      _executor.execute(&AsyncWaiter::run, h.address());
+    }
+
+    void await_resume() const noexcept { }
+
+  }; /* ScheduleAwaiter */
+
+  //! @return ScheduleAwaiter that resumes the awaiting coroutine on the given executor
+  inline ScheduleAwaiter schedule(PoolExecutor& executor) {
+    return ScheduleAwaiter(executor);
+  }
+
+  /**
+   * @class AsyncMutex
+   * @version 2.3.3
+   *
+   * A mutex for coroutines. A coroutine that co_awaits acquire() while the 
+   * mutex is held is suspended, rather than blocking its thread, and is resumed
+   * on the PoolExecutor once the mutex is handed to it. Ownership passes 
+   * directly to the first waiter, in FIFO order.
+   *
+   * A coroutine can move between threads while it holds the mutex, so the mutex
+   * belongs to no thread; release() may be called from any thread.
+   *
+   * @code
+   *
+   * co_await mutex.acquire();
+   * ...
+   * mutex.release();
+   *
+   * @endcode
+   */
+  class AsyncMutex : private NonCopyable {
+
+    friend class AsyncCondition;
+
+    FastMutex _lock;
+    bool _locked;
+    AsyncWaiterList _waiters;
+
+    PoolExecutor& _executor;
+
+    //! Take the mutex or queue the waiter; false if it was taken
+    bool enqueue(AsyncWaiter& w) {
+
+      Guard<FastMutex> g(_lock);
+
+      if(!_locked) {
+
+        _locked = true;
+        return false;
+
+      }
+
+      _waiters.push(&w);
+      return true;
+
+    }
+
+    //! Hand the mutex to a waiter, now or once it is released
+    void handoff(AsyncWaiter& w) {
+
+      {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_locked) {
+
+          _waiters.push(&w);
+          return;
+
+        }
+
+        _locked = true;
+
+      }
+
+      w.resume();
+
+    }
+
+  public:
+
+    //! Awaiter returned by acquire()
+    class Acquire : public AsyncWaiter {
+
+      AsyncMutex& _mutex;
+
+    public:
+
+      explicit Acquire(AsyncMutex& mutex) : AsyncWaiter(mutex._executor), _mutex(mutex) { }
+
+      bool await_ready() {
+        return _mutex.tryAcquire();
+      }
+
+      bool await_suspend(std::coroutine_handle<> h) {
+
+        handle = h;
+        return _mutex.enqueue(*this);
+
+      }
+
+      void await_resume() const noexcept { }
+
+    };
+
+    /**
+     * Create an AsyncMutex.
+     *
+     * @param executor PoolExecutor suspended coroutines are resumed on
+     */
+    explicit AsyncMutex(PoolExecutor& executor) : _locked(false), _executor(executor) { }
+
+    //! @return Acquire awaiter that completes once the calling coroutine holds the mutex
+    Acquire acquire() {
+      return Acquire(*this);
+    }
+
+    /**
+     * Acquire the mutex if it is free, without suspending.
+     *
+     * @return <em>true</em> if the mutex was acquired
+     */
+    bool tryAcquire() {
+
+      Guard<FastMutex> g(_lock);
+
+      if(_locked)
+        return false;
+
+      _locked = true;
+      return true;
+
+    }
+
+    /**
+     * Release the mutex, handing it to the first waiter if there is one.
+     *
+     * @exception InvalidOp_Exception thrown if the mutex is not held
+     */
+    void release() {
+
+      AsyncWaiter* w;
+
+      {
+
+        Guard<FastMutex> g(_lock);
+
+        if(!_locked)
+          throw InvalidOp_Exception();
+
+        // The mutex stays locked, on behalf of the waiter
+        w = _waiters.pop();
+
+        if(!w)
+          _locked = false;
+
+      }
+
+      if(w)
+        w->resume();
+
+    }
+
+  }; /* AsyncMutex */
+
+  /**
+   * @class AsyncCondition
+   * @version 2.3.3
+   *
+   * A condition variable for coroutines, used with an AsyncMutex. Awaiting 
+   * wait() releases the mutex and suspends the coroutine; once signaled, it is
+   * queued for the mutex and resumed holding it, without a thread having to 
+   * wake up in between.
+   *
+   * @code
+   *
+   * co_await mutex.acquire();
+   *
+   * while(!ready)
+   *   co_await condition.wait();
+   *
+   * mutex.release();
+   *
+   * @endcode
+   */
+  class AsyncCondition : private NonCopyable {
+
+    FastMutex _lock;
+    AsyncWaiterList _waiters;
+
+    AsyncMutex& _mutex;
+
+    void enqueue(AsyncWaiter& w) {
+
+      {
+        Guard<FastMutex> g(_lock);
+        _waiters.push(&w);
+      }
+
+      // Released after the waiter is queued, so no signal is missed
+      _mutex.release();
+
+    }
+
+  public:
+
+    //! Awaiter returned by wait()
+    class Wait : public AsyncWaiter {
+
+      AsyncCondition& _condition;
+
+    public:
+
+      explicit Wait(AsyncCondition& condition) 
+        : AsyncWaiter(condition._mutex._executor), _condition(condition) { }
+
+      bool await_ready() const noexcept {
+        return false;
+      }
+
+      void await_suspend(std::coroutine_handle<> h) {
+
+        handle = h;
+        _condition.enqueue(*this);
+
+      }
+
+      void await_resume() const noexcept { }
+
+    };
+
+    /**
+     * Create an AsyncCondition.
+     *
+     * @param mutex AsyncMutex held by the coroutines that wait
+     */
+    explicit AsyncCondition(AsyncMutex& mutex) : _mutex(mutex) { }
+
+    /**
+     * @return Wait awaiter that releases the mutex, and completes once the 
+     *         condition is signaled and the mutex is held again
+     */
+    Wait wait() {
+      return Wait(*this);
+    }
+
+    //! Wake the first waiting coroutine, if any
+    void signal() {
+
+      AsyncWaiter* w;
+
+      {
+        Guard<FastMutex> g(_lock);
+        w = _waiters.pop();
+      }
+
+      if(w)
+        _mutex.handoff(*w);
+
+    }
+
+    //! Wake every waiting coroutine
+    void broadcast() {
+
+      AsyncWaiterList waiters;
+
+      {
+
+        Guard<FastMutex> g(_lock);
+        std::swap(waiters, _waiters);
+
+      }
+
+      while(AsyncWaiter* w = waiters.pop())
+        _mutex.handoff(*w);
+
+    }
+
+  }; /* AsyncCondition */
+
+  /**
+   * @class AsyncSemaphore
+   * @version 2.3.3
+   *
+   * A counting semaphore for coroutines. A coroutine that co_awaits acquire()
+   * while the count is 0 is suspended, and resumed on the PoolExecutor once 
+   * a release() hands it a permit.
+   */
+  class AsyncSemaphore : private NonCopyable {
+
+    FastMutex _lock;
+    size_t _count;
+    AsyncWaiterList _waiters;
+
+    PoolExecutor& _executor;
+
+    //! Take a permit or queue the waiter; false if a permit was taken
+    bool enqueue(AsyncWaiter& w) {
+
+      Guard<FastMutex> g(_lock);
+
+      if(_count > 0) {
+
+        --_count;
+        return false;
+
+      }
+
+      _waiters.push(&w);
+      return true;
+
+    }
+
+  public:
+
+    //! Awaiter returned by acquire()
+    class Acquire : public AsyncWaiter {
+
+      AsyncSemaphore& _semaphore;
+
+    public:
+
+      explicit Acquire(AsyncSemaphore& semaphore) 
+        : AsyncWaiter(semaphore._executor), _semaphore(semaphore) { }
+
+      bool await_ready() {
+        return _semaphore.tryAcquire();
+      }
+
+      bool await_suspend(std::coroutine_handle<> h) {
+
+        handle = h;
+        return _semaphore.enqueue(*this);
+
+      }
+
+      void await_resume() const noexcept { }
+
+    };
+
+    /**
+     * Create an AsyncSemaphore.
+     *
+     * @param executor PoolExecutor suspended coroutines are resumed on
+     * @param count initial number of permits
+     */
+    AsyncSemaphore(PoolExecutor& executor, size_t count = 1) : _count(count), _executor(executor) { }
+
+    //! @return Acquire awaiter that completes once the calling coroutine holds a permit
+    Acquire acquire() {
+      return Acquire(*this);
+    }
+
+    /**
+     * Take a permit if one is available, without suspending.
+     *
+     * @return <em>true</em> if a permit was taken
+     */
+    bool tryAcquire() {
+
+      Guard<FastMutex> g(_lock);
+
+      if(_count == 0)
+        return false;
+
+      --_count;
+      return true;
+
+    }
+
+    //! Return a permit, handing it to the first waiter if there is one
+    void release() {
+
+      AsyncWaiter* w;
+
+      {
+
+        Guard<FastMutex> g(_lock);
+
+        w = _waiters.pop();
+
+        if(!w)
+          ++_count;
+
+      }
+
+      if(w)
+        w->resume();
+
+    }
+
+    //! @return size_t the number of permits available
+    size_t count() {
+
+      Guard<FastMutex> g(_lock);
+      return _count;
+
+    }
+
+  }; /* AsyncSemaphore */
+
+  /**
+   * @class AsyncQueue
+   * @version 2.3.3
+   *
+   * An unbounded queue for coroutines. A coroutine that co_awaits next() on an
+   * empty queue is suspended, and resumed on the PoolExecutor with the value 
+   * once one is added; the value is handed to it directly. 
+   *
+   * Like the other Queues, a canceled AsyncQueue accepts no more values; 
+   * next() returns the values still queued and then throws 
+   * Cancellation_Exception.
+   */
+  template <class T>
+  class AsyncQueue : private NonCopyable {
+
+    FastMutex _lock;
+    std::deque<T> _items;
+    AsyncWaiterList _waiters;
+    bool _canceled;
+
+    PoolExecutor& _executor;
+
+  public:
+
+    //! Awaiter returned by next()
+    class Next : public AsyncWaiter {
+
+      friend class AsyncQueue;
+
+      AsyncQueue& _queue;
+      std::optional<T> _value;
+
+    public:
+
+      explicit Next(AsyncQueue& queue) : AsyncWaiter(queue._executor), _queue(queue) { }
+
+      bool await_ready() {
+        return _queue.tryNext(_value);
+      }
+
+      bool await_suspend(std::coroutine_handle<> h) {
+
+        handle = h;
+        return _queue.enqueue(*this);
+
+      }
+
+      T await_resume() {
+
+        if(!_value)
+          throw Cancellation_Exception();
+
+        return std::move(*_value);
+
+      }
+
+    };
+
+  private:
+
+    //! Take a value, if there is one or the queue is canceled, or queue the waiter
+    bool enqueue(Next& w) {
+
+      Guard<FastMutex> g(_lock);
+
+      if(!_items.empty()) {
+
+        w._value.emplace(std::move(_items.front()));
+        _items.pop_front();
+
+        return false;
+
+      }
+
+      if(_canceled)
+        return false;
+
+      _waiters.push(&w);
+      return true;
+
+    }
+
+    //! Take a value, true if there was one or the queue is canceled
+    bool tryNext(std::optional<T>& value) {
+
+      Guard<FastMutex> g(_lock);
+
+      if(_items.empty())
+        return _canceled;
+
+      value.emplace(std::move(_items.front()));
+      _items.pop_front();
+
+      return true;
+
+    }
+
+  public:
+
+    /**
+     * Create an AsyncQueue.
+     *
+     * @param executor PoolExecutor suspended coroutines are resumed on
+     */
+    explicit AsyncQueue(PoolExecutor& executor) : _canceled(false), _executor(executor) { }
+
+    /**
+     * Add a value, handing it to the first waiting coroutine if there is one.
+     *
+     * @exception Cancellation_Exception thrown if the queue has been canceled
+     */
+    void add(const T& item) {
+
+      AsyncWaiter* w;
+
+      {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_canceled)
+          throw Cancellation_Exception();
+
+        w = _waiters.pop();
+
+        if(w)
+          static_cast<Next*>(w)->_value.emplace(item);
+        else
+          _items.push_back(item);
+
+      }
+
+      if(w)
+        w->resume();
+
+    }
+
+    /**
+     * @return Next awaiter that completes with the next value
+     *
+     * @exception Cancellation_Exception thrown by co_await once the queue is 
+     *            canceled and empty
+     */
+    Next next() {
+      return Next(*this);
+    }
+
+    //! Cancel the queue, resuming every waiting coroutine with a Cancellation_Exception
+    void cancel() {
+
+      AsyncWaiterList waiters;
+
+      {
+
+        Guard<FastMutex> g(_lock);
+
+        _canceled = true;
+        std::swap(waiters, _waiters);
+
+      }
+
+      while(AsyncWaiter* w = waiters.pop())
+        w->resume();
+
+    }
+
+    bool isCanceled() {
+
+      Guard<FastMutex> g(_lock);
+      return _canceled;
+
+    }
+
+    size_t size() {
+
+      Guard<FastMutex> g(_lock);
+      return _items.size();
+
+    }
+
+  }; /* AsyncQueue */
+
+} // namespace ZThread
+
+#endif // ZTHREAD_COROUTINES
+
+#endif // __ZTCOROUTINES_H__
@@ -239,6 +239,24 @@ class Future_Exception : public Synchronization_Exception {
 
 };
 
+/**
+ * @class Overflow_Exception
+ *
+ * Thrown when a task is rejected because the queue of a bounded executor 
+ * is full.
+ */
+class Overflow_Exception : public Synchronization_Exception {
+
+  public:
+
+  //! Create a new exception
+  Overflow_Exception() : Synchronization_Exception("Queue full") { }
+
+  //! Create a new exception
+  Overflow_Exception(const char* msg) : Synchronization_Exception(msg) { }
+
+};
+
 };
 
 #endif // __ZTEXCEPTIONS_H__
@@ -23,6 +23,7 @@
 #ifndef __ZTEXECUTOR_H__
 #define __ZTEXECUTOR_H__
 
+#include "zthread/FutureTask.h"
 #include "zthread/Thread.h"
 #include "zthread/Waitable.h"
 
@@ -45,6 +46,9 @@ namespace ZThread {
    * - <em>execute</em>()ing task with an Executor will submit the task, scheduling
    *   it for execution at some future time depending on the Executor being used.
    *
+   * - <em>submit</em>()ing a Callable with an Executor will execute() it the same
+   *   way, returning a Future for its result.
+   *
    * <b>Disabling</b>
    *
    * - <em>cancel</em>()ing an Executor will cause it to stop accepting 
@@ -86,6 +90,32 @@ namespace ZThread {
      *            the invocation of this function.
      */
     virtual void execute(const Task& task) = 0;
+
+    /**
+     * Submit a Callable to this Executor.
+     *
+     * @param c Callable to be run by a thread managed by this executor, the 
+     *        Executor takes ownership of it
+     *
+     * @return Future for the result of the Callable
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     *
+     * @see execute(const Task& task)
+     */
+    template <typename T>
+    Future<T> submit(Callable<T>* c) {
+
+      FutureTask<T>* task = new FutureTask<T>(c);
+      Task t(task);
+
+      Future<T> result(task->getFuture());
+      execute(t);
+
+      return result;
+
+    }
   
   };
 
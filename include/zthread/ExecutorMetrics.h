@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTEXECUTORMETRICS_H__
+#define __ZTEXECUTORMETRICS_H__
+
+#include "zthread/Config.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace ZThread {
+
+  /**
+   * @class LatencyHistogram
+   * @version 2.3.3
+   *
+   * Distribution of durations, in buckets whose bounds are powers of two 
+   * microseconds. Bucket <i>i</i> counts durations of at least 2^<i>i</i> and 
+   * less than 2^(<i>i</i>+1) microseconds; bucket 0 also counts durations 
+   * under a microsecond, and the last bucket counts everything longer.
+   */
+  class ZTHREAD_API LatencyHistogram {
+  public:
+
+    //! Number of buckets
+    enum { BUCKETS = 32 };
+
+    //! Samples counted in each bucket
+    size_t counts[BUCKETS];
+
+    //! Sum of all the samples, in microseconds
+    unsigned long long total;
+
+    //! Create an empty histogram
+    LatencyHistogram();
+
+    //! @return size_t the number of samples
+    size_t samples() const;
+
+    //! @return unsigned long long the mean of the samples in microseconds, or 0 if there are none
+    unsigned long long mean() const;
+
+    /**
+     * Estimate a percentile of the samples.
+     *
+     * @param p percentile, between 0 and 100 
+     *
+     * @return unsigned long long upper bound, in microseconds, of the bucket 
+     *         the percentile falls in; 0 if there are no samples
+     */
+    unsigned long long percentile(double p) const;
+
+    //! Count a sample, in microseconds
+    void add(unsigned long long duration);
+
+    //! Add the samples of another histogram to this one
+    LatencyHistogram& operator+=(const LatencyHistogram& h);
+
+  }; /* LatencyHistogram */
+
+  /**
+   * @class WorkerMetrics
+   * @version 2.3.3
+   *
+   * What one worker of a PoolExecutor has done since it started. Durations 
+   * are in microseconds.
+   */
+  class ZTHREAD_API WorkerMetrics {
+  public:
+
+    //! Tasks the worker has run
+    size_t completed;
+
+    //! Time spent running tasks
+    unsigned long long busy;
+
+    //! Time spent waiting for tasks
+    unsigned long long idle;
+
+    //! Processor time used by the tasks the worker ran, where the system can measure it
+    unsigned long long cpu;
+
+    WorkerMetrics();
+
+    //! @return double fraction of its lifetime the worker spent running tasks
+    double utilization() const;
+
+    //! Add the metrics of another worker to these
+    WorkerMetrics& operator+=(const WorkerMetrics& w);
+
+  }; /* WorkerMetrics */
+
+  /**
+   * @class ExecutorMetrics
+   * @version 2.3.3
+   *
+   * A snapshot of the metrics an executor collects. The counters are read 
+   * without stopping the workers, so a snapshot taken while tasks are being 
+   * submitted is only approximately consistent; the depth, for instance, 
+   * may lag the queue by a task or two.
+   *
+   * When the library is compiled with ZTHREAD_DISABLE_METRICS, no timings are 
+   * collected; only the number of workers, the depth, and the counts of tasks
+   * dropped, expired, missed, rejected and discarded are reported.
+   */
+  class ZTHREAD_API ExecutorMetrics {
+  public:
+
+    //! Tasks accepted by the executor
+    size_t submitted;
+
+    //! Tasks that have completed
+    size_t completed;
+
+    //! Tasks dropped without running, because their CancellationToken was canceled
+    size_t dropped;
+
+    //! Tasks dropped without running, because their deadline passed first
+    size_t expired;
+
+    //! Tasks that completed after their deadline
+    size_t missed;
+
+    //! Tasks refused because the queue was full
+    size_t rejected;
+
+    //! Tasks discarded from the queue to make room for others
+    size_t discarded;
+
+    //! Tasks waiting in the queue
+    size_t depth;
+
+    //! Time tasks waited in the queue before they started
+    LatencyHistogram queueWait;
+
+    //! Time tasks took to run
+    LatencyHistogram runTime;
+
+    //! Totals for every worker, including those that have retired, and for
+    //! tasks run by threads helping the executor
+    WorkerMetrics total;
+
+    //! Metrics of each worker currently running
+    std::vector<WorkerMetrics> workers;
+
+    ExecutorMetrics();
+
+  }; /* ExecutorMetrics */
+
+} // namespace ZThread
+
+#endif // __ZTEXECUTORMETRICS_H__
@@ -0,0 +1,530 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTURE_H__
+#define __ZTFUTURE_H__
+
+#include "zthread/Callable.h"
+#include "zthread/Exceptions.h"
+#include "zthread/FutureImpl.h"
+#include "zthread/Waitable.h"
+
+namespace ZThread {
+
+  template <typename T> class Future;
+  template <typename T> class Promise;
+
+  /**
+   * @class Continuation
+   * @version 2.3.3
+   *
+   * Encapsulates a task that is run once the result of a Future is available,
+   * producing a new result.
+   *
+   * @see Future::then()
+   */
+  template <typename T, typename U>
+    class Continuation {
+    public:
+
+    //! Continuations should never throw in their destructors
+    virtual ~Continuation() {}
+
+    /**
+     * Task to be performed once a result is available.
+     *
+     * @param result completed Future, get() will not block
+     * @return the new result
+     */
+    virtual U call(Future<T>& result) = 0;
+
+  }; /* Continuation */
+
+  /**
+   * @class Future
+   * @version 2.3.3
+   *
+   * A Future is a handle to a result that will be provided later, typically 
+   * by a task submit()ted to an Executor, or through a Promise. Futures are 
+   * reference counted handles and may be freely copied; each copy refers to 
+   * the same result.
+   *
+   * - <em>get</em>()ing a result blocks the calling thread until the result
+   *   is available. A result that is already available is returned without 
+   *   taking any lock.
+   *
+   * - <em>then</em>() chains a Continuation that runs once the result is
+   *   available, returning a Future for the result of that Continuation.
+   *
+   * - <em>cancel</em>()ing a Future whose result has not yet been provided 
+   *   causes the result to be discarded when it is provided.
+   *
+   * Like all Waitable objects, Futures are sensitive to Thread::interupt(). 
+   *
+   * @see Promise
+   * @see Executor::submit()
+   */
+  template <typename T>
+    class Future : public Waitable {
+
+      //! Shared state
+      FutureState<T>* _state;
+
+    public:
+
+      /**
+       * Create a Future for the given shared state.
+       *
+       * @param state shared state, a new reference is added to it
+       */
+      explicit Future(FutureState<T>* state) : _state(state) {
+        _state->addReference();
+      }
+
+      Future(const Future& f) : _state(f._state) {
+        _state->addReference();
+      }
+
+      virtual ~Future() {
+        _state->delReference();
+      }
+
+      const Future& operator=(const Future& f) {
+
+        f._state->addReference();
+        _state->delReference();
+
+        _state = f._state;
+        return *this;
+
+      }
+
+      /**
+       * Get the result, blocking the calling thread until it is available.
+       *
+       * @return the result
+       *
+       * @exception Interrupted_Exception thrown if the calling thread is interrupted
+       *            before the result is available.
+       * @exception Future_Exception thrown if the task providing the result failed.
+       * @exception Cancellation_Exception thrown if the Future was canceled.
+       */
+      T get() {
+
+        if(!_state->isDone())
+          _state->wait();
+
+        _state->check();
+        return _state->value();
+
+      }
+
+      /**
+       * Get the result, blocking the calling thread until it is available or 
+       * until the timeout expires.
+       *
+       * @param timeout maximum amount of time (milliseconds) to wait
+       *
+       * @return the result
+       *
+       * @exception Timeout_Exception thrown if the timeout expires before
+       *            the result is available.
+       * @exception Interrupted_Exception thrown if the calling thread is interrupted
+       *            before the result is available.
+       * @exception Future_Exception thrown if the task providing the result failed.
+       * @exception Cancellation_Exception thrown if the Future was canceled.
+       */
+      T get(unsigned long timeout) {
+
+        if(!_state->isDone() && !_state->wait(timeout))
+          throw Timeout_Exception();
+
+        _state->check();
+        return _state->value();
+
+      }
+
+      /**
+       * Test whether the result is available, without blocking. 
+       *
+       * @return true if the result has been provided, has failed or was canceled.
+       */
+      bool isDone() const {
+        return _state->isDone();
+      }
+
+      /**
+       * Cancel the Future. A result provided later is discarded.
+       *
+       * @return true if the Future was canceled by this invocation, false if a 
+       *         result had already been provided.
+       */
+      bool cancel() {
+        return _state->cancel();
+      }
+
+      /**
+       * @return true if the Future was canceled.
+       */
+      bool isCanceled() const {
+        return _state->isCanceled();
+      }
+
+      /**
+       * Block the calling thread until the result is available.
+       *
+       * @see Waitable::wait()
+       */
+      virtual void wait() {
+        _state->wait();
+      }
+
+      /**
+       * Block the calling thread until the result is available or until
+       * the timeout expires.
+       *
+       * @see Waitable::wait(unsigned long timeout)
+       */
+      virtual bool wait(unsigned long timeout) {
+        return _state->wait(timeout);
+      }
+
+      /**
+       * Run a Continuation once the result is available. If the result is 
+       * already available, the Continuation is run immediately by the calling 
+       * thread; otherwise it is run by the thread that provides the result.
+       *
+       * @param c Continuation to run, the Future takes ownership of it
+       *
+       * @return Future for the result of the Continuation
+       */
+      template <typename U>
+      Future<U> then(Continuation<T, U>* c);
+
+      /**
+       * Submit a Continuation to an Executor once the result is available. The
+       * Executor must outlive the Future.
+       *
+       * @param executor Executor that runs the Continuation
+       * @param c Continuation to run, the Future takes ownership of it
+       *
+       * @return Future for the result of the Continuation, canceled if the 
+       *         Executor rejects the Continuation
+       */
+      template <typename U, class ExecutorT>
+      Future<U> then(ExecutorT& executor, Continuation<T, U>* c);
+
+    }; /* Future */
+
+  /**
+   * @class Promise
+   * @version 2.3.3
+   *
+   * A Promise provides the result for a Future. Promises are reference counted 
+   * handles and may be freely copied; each copy refers to the same result.
+   * Only the first result provided is kept.
+   *
+   * @see Future
+   */
+  template <typename T>
+    class Promise {
+
+      //! Shared state
+      FutureState<T>* _state;
+
+    public:
+
+      //! Create a Promise for a new result
+      Promise() : _state(new FutureState<T>) { }
+
+      Promise(const Promise& p) : _state(p._state) {
+        _state->addReference();
+      }
+
+      ~Promise() {
+        _state->delReference();
+      }
+
+      const Promise& operator=(const Promise& p) {
+
+        p._state->addReference();
+        _state->delReference();
+
+        _state = p._state;
+        return *this;
+
+      }
+
+      //! Get a Future for the result
+      Future<T> getFuture() const {
+        return Future<T>(_state);
+      }
+
+      /**
+       * Provide the result.
+       *
+       * @return false if a result had already been provided, or the Future 
+       *         was canceled.
+       */
+      bool set(const T& value) {
+        return _state->set(value);
+      }
+
+      /**
+       * Fail the result, get() will throw a Future_Exception.
+       *
+       * @param error description of the failure
+       *
+       * @return false if a result had already been provided, or the Future 
+       *         was canceled.
+       */
+      bool fail(const char* error) {
+        return _state->fail(error);
+      }
+
+      /**
+       * Fail the result with a description of the exception currently being 
+       * handled. Should only be used from within a catch block.
+       *
+       * @return false if a result had already been provided, or the Future 
+       *         was canceled.
+       */
+      bool failCurrent() {
+        return _state->failCurrent();
+      }
+
+      //! Test whether a result has been provided, or the Future was canceled
+      bool isDone() const {
+        return _state->isDone();
+      }
+
+    }; /* Promise */
+
+  template <>
+    class Promise<void> {
+
+      FutureState<void>* _state;
+
+    public:
+
+      Promise() : _state(new FutureState<void>) { }
+
+      Promise(const Promise& p) : _state(p._state) {
+        _state->addReference();
+      }
+
+      ~Promise() {
+        _state->delReference();
+      }
+
+      const Promise& operator=(const Promise& p) {
+
+        p._state->addReference();
+        _state->delReference();
+
+        _state = p._state;
+        return *this;
+
+      }
+
+      Future<void> getFuture() const {
+        return Future<void>(_state);
+      }
+
+      bool set() {
+        return _state->set();
+      }
+
+      bool fail(const char* error) {
+        return _state->fail(error);
+      }
+
+      bool failCurrent() {
+        return _state->failCurrent();
+      }
+
+      bool isDone() const {
+        return _state->isDone();
+      }
+
+    }; /* Promise<void> */
+
+  /**
+   * @class PromiseSetter
+   *
+   * Provide a result to a Promise from a Callable or a Continuation, 
+   * ignoring the result for void.
+   */
+  template <typename T>
+    struct PromiseSetter {
+
+      static void call(Promise<T>& p, Callable<T>& c) {
+        p.set(c.call());
+      }
+
+      template <typename S>
+      static void call(Promise<T>& p, Continuation<S, T>& c, Future<S>& f) {
+        p.set(c.call(f));
+      }
+
+    };
+
+  template <>
+    struct PromiseSetter<void> {
+
+      static void call(Promise<void>& p, Callable<void>& c) {
+        c.call();
+        p.set();
+      }
+
+      template <typename S>
+      static void call(Promise<void>& p, Continuation<S, void>& c, Future<S>& f) {
+        c.call(f);
+        p.set();
+      }
+
+    };
+
+  /**
+   * @class ContinuationTask
+   *
+   * Runs a Continuation for a completed result. The task only holds a reference 
+   * to the result once it has been retain()ed, so a Continuation waiting for
+   * a result never keeps that result alive.
+   */
+  template <typename T, typename U>
+    class ContinuationTask : public Runnable {
+
+      FutureState<T>* _source;
+      bool _retained;
+
+      Continuation<T, U>* _continuation;
+      Promise<U> _promise;
+
+    public:
+
+      ContinuationTask(FutureState<T>* source, Continuation<T, U>* c, const Promise<U>& p)
+        : _source(source), _retained(false), _continuation(c), _promise(p) { }
+
+      virtual ~ContinuationTask() {
+
+        if(_retained)
+          _source->delReference();
+
+        delete _continuation;
+
+      }
+
+      //! Hold a reference to the result so the task can be run later
+      void retain() {
+
+        if(!_retained) {
+
+          _source->addReference();
+          _retained = true;
+
+        }
+
+      }
+
+      //! Fail the new result without running the Continuation
+      void reject(const char* error) {
+        _promise.fail(error);
+      }
+
+      void run() {
+
+        // Nothing to do if the new result was canceled
+        if(_promise.isDone())
+          return;
+
+        Future<T> result(_source);
+
+        try {
+          PromiseSetter<U>::call(_promise, *_continuation, result);
+        } catch(...) {
+          _promise.failCurrent();
+        }
+
+      }
+
+    }; /* ContinuationTask */
+
+  /**
+   * @class ContinuationDispatch
+   *
+   * Submits a ContinuationTask to an Executor once its result is available.
+   */
+  template <typename T, typename U, class ExecutorT>
+    class ContinuationDispatch : public Runnable {
+
+      ExecutorT& _executor;
+
+      ContinuationTask<T, U>* _continuation;
+      Task _task;
+
+    public:
+
+      ContinuationDispatch(ExecutorT& executor, ContinuationTask<T, U>* task)
+        : _executor(executor), _continuation(task), _task(task) { }
+
+      void run() {
+
+        _continuation->retain();
+
+        try {
+          _executor.execute(_task);
+        } catch(...) {
+          _continuation->reject("Continuation rejected by the Executor");
+        }
+
+      }
+
+    }; /* ContinuationDispatch */
+
+  template <typename T>
+  template <typename U>
+    Future<U> Future<T>::then(Continuation<T, U>* c) {
+
+      Promise<U> p;
+      _state->whenDone( Task(new ContinuationTask<T, U>(_state, c, p)) );
+
+      return p.getFuture();
+
+    }
+
+  template <typename T>
+  template <typename U, class ExecutorT>
+    Future<U> Future<T>::then(ExecutorT& executor, Continuation<T, U>* c) {
+
+      Promise<U> p;
+      ContinuationTask<T, U>* task = new ContinuationTask<T, U>(_state, c, p);
+
+      _state->whenDone( Task(new ContinuationDispatch<T, U, ExecutorT>(executor, task)) );
+
+      return p.getFuture();
+
+    }
+
+} // namespace ZThread
+
+#endif // __ZTFUTURE_H__
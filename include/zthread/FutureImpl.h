@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTUREIMPL_H__
+#define __ZTFUTUREIMPL_H__
+
+#include "zthread/Task.h"
+#include "zthread/NonCopyable.h"
+
+#include <new>
+#include <string>
+
+namespace ZThread {
+
+  /**
+   * @class FutureImpl
+   * @version 2.3.3
+   *
+   * The part of the state shared by a Future and its Promise that does not 
+   * depend on the type of the result. 
+   *
+   * The state of the result is kept in a single word that is updated with 
+   * atomic operations, so testing or reading a result that is already available
+   * never takes a lock. A lock and a Condition are only created the first time 
+   * a thread has to block for the result, or a continuation has to be deferred.
+   *
+   * @see Future
+   * @see Promise
+   */
+  class ZTHREAD_API FutureImpl : private NonCopyable {
+  public:
+
+    //! States of a result
+    typedef enum { 
+
+      PENDING,   
+      SETTING,   
+      DONE,      
+      FAILED,    
+      CANCELED  
+
+    } STATE;
+
+  private:
+
+    //! Current STATE, only updated atomically
+    volatile long _state;
+
+    //! Intrusive reference count
+    volatile long _count;
+
+    //! Lock, Condition and continuations, created on demand
+    void* volatile _waiters;
+
+    //! Description of the failure for a FAILED result
+    std::string _error;
+
+  public:
+
+    //! Create a PENDING FutureImpl with a single reference
+    FutureImpl();
+
+    //! Destroy a FutureImpl
+    virtual ~FutureImpl();
+
+    //! Add a reference
+    void addReference();
+
+    //! Remove a reference, deleting this object when none remain
+    void delReference();
+
+    //! Test for a result, without blocking
+    bool isDone() const;
+
+    //! Test for cancellation, without blocking
+    bool isCanceled() const;
+
+    /**
+     * Cancel a PENDING result.
+     *
+     * @return true if the result was canceled by this invocation.
+     */
+    bool cancel();
+
+    /**
+     * Block the calling thread until a result is available.
+     *
+     * @exception Interrupted_Exception thrown if the calling thread is interrupted
+     *            before a result is available.
+     */
+    void wait();
+
+    /**
+     * Block the calling thread until a result is available or until
+     * the timeout expires.
+     *
+     * @param timeout maximum amount of time (milliseconds) to wait
+     *
+     * @return true if a result is available.
+     *
+     * @exception Interrupted_Exception thrown if the calling thread is interrupted
+     *            before a result is available.
+     */
+    bool wait(unsigned long timeout);
+
+    /**
+     * Throw the failure associated with a result.
+     *
+     * @exception Future_Exception thrown if the result FAILED.
+     * @exception Cancellation_Exception thrown if the result was CANCELED.
+     */
+    void check() const;
+
+    /**
+     * Run a task once a result is available. If a result is already available 
+     * the task is run immediately by the calling thread, otherwise it is run by 
+     * the thread that provides the result.
+     *
+     * @param task Task to run
+     */
+    void whenDone(const Task& task);
+
+    /**
+     * Fail a PENDING result.
+     *
+     * @param error description of the failure
+     *
+     * @return false if a result had already been provided.
+     */
+    bool fail(const char* error);
+
+    /**
+     * Fail a PENDING result with a description of the exception currently 
+     * being handled. Should only be used from within a catch block.
+     *
+     * @return false if a result had already been provided.
+     */
+    bool failCurrent();
+
+  protected:
+
+    /**
+     * Begin to set a result.
+     *
+     * @return true if the result was PENDING and is now SETTING.
+     */
+    bool claim();
+
+    /**
+     * Finish setting a result claim()ed by the calling thread, waking waiters
+     * and running the continuations.
+     *
+     * @param state DONE or FAILED
+     * @param error description of a failure
+     */
+    void complete(STATE state, const char* error = 0);
+
+    //! Test for a DONE result
+    bool isSet() const;
+
+  }; /* FutureImpl */
+
+  /**
+   * @class FutureState
+   * @version 2.3.3
+   *
+   * The shared state of a Future. The result is constructed in place, so the 
+   * state and the result share a single allocation.
+   */
+  template <typename T>
+    class FutureState : public FutureImpl {
+
+    //! Storage for the result, aligned for any type
+    union {
+      char _buffer[sizeof(T)];
+      long double _alignDouble;
+      void* _alignPointer;
+      long _alignLong;
+    } _storage;
+
+  public:
+
+    virtual ~FutureState() {
+
+      if(isSet())
+        value().~T();
+
+    }
+
+    /**
+     * Set the result.
+     *
+     * @return false if a result had already been provided.
+     */
+    bool set(const T& v) {
+
+      if(!claim())
+        return false;
+
+      try {
+
+        new(_storage._buffer) T(v);
+
+      } catch(...) {
+
+        complete(FAILED, "Result could not be copied");
+        return true;
+
+      }
+
+      complete(DONE);
+      return true;
+
+    }
+
+    //! Get the result, only valid once the state is DONE
+    T& value() {
+      return *reinterpret_cast<T*>(_storage._buffer);
+    }
+
+  }; /* FutureState */
+
+  template <>
+    class FutureState<void> : public FutureImpl {
+  public:
+
+    bool set() {
+
+      if(!claim())
+        return false;
+
+      complete(DONE);
+      return true;
+
+    }
+
+    void value() { }
+
+  }; /* FutureState<void> */
+
+} // namespace ZThread
+
+#endif // __ZTFUTUREIMPL_H__
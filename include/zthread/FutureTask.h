@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTURETASK_H__
+#define __ZTFUTURETASK_H__
+
+#include "zthread/Future.h"
+#include "zthread/Runnable.h"
+
+namespace ZThread {
+
+  /**
+   * @class FutureTask
+   * @version 2.3.3
+   *
+   * A Runnable that runs a Callable and provides its result to a Future. 
+   * An exception thrown by the Callable fails the Future, rather than 
+   * escaping the thread that runs the task. 
+   *
+   * A FutureTask whose Future was canceled before it is run does not run 
+   * its Callable.
+   *
+   * A FutureTask that is destroyed without having been run, for instance 
+   * because an Executor discarded it, cancels its Future. get() then throws 
+   * a Cancellation_Exception rather than blocking forever.
+   *
+   * @see Executor::submit()
+   */
+  template <typename T>
+    class FutureTask : public Runnable {
+
+      Callable<T>* _callable;
+      Promise<T> _promise;
+
+    public:
+
+      /**
+       * Create a FutureTask
+       *
+       * @param c Callable to run, the FutureTask takes ownership of it
+       */
+      FutureTask(Callable<T>* c) : _callable(c) { }
+
+      virtual ~FutureTask() {
+
+        // Never leave the Future pending, break the promise
+        if(!_promise.isDone()) {
+          Future<T> f(_promise.getFuture());
+          f.cancel();
+        }
+
+        delete _callable;
+
+      }
+
+      //! Get a Future for the result of the Callable
+      Future<T> getFuture() const {
+        return _promise.getFuture();
+      }
+
+      void run() {
+
+        if(_promise.isDone())
+          return;
+
+        try {
+          PromiseSetter<T>::call(_promise, *_callable);
+        } catch(...) {
+          _promise.failCurrent();
+        }
+
+      }
+
+    }; /* FutureTask */
+
+} // namespace ZThread
+
+#endif // __ZTFUTURETASK_H__
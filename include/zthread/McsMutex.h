@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTMCSMUTEX_H__
+#define __ZTMCSMUTEX_H__
+
+#include "zthread/Guard.h"
+#include "zthread/Lockable.h"
+#include "zthread/NonCopyable.h"
+
+namespace ZThread { 
+
+  /**
+   * @class McsMutex
+   * @version 2.3.3
+   *
+   * An McsMutex is a queue lock for heavily contended critical sections. Each 
+   * waiting thread spins on a node of its own, kept on its own cache line, and 
+   * the releasing thread hands the lock to its successor by writing only to that 
+   * successor's node. The cost of a handoff does not grow with the number of 
+   * waiting threads, unlike a FastMutex where every waiter watches the same word.
+   *
+   * A Guard<McsMutex> keeps the queue node on the stack, inside the Guard, so 
+   * locking through a Guard allocates nothing. The Lockable interface can still 
+   * be used directly, in which case a node is allocated by acquire() and freed by
+   * release().
+   *
+   * Waiters spin and then yield their processor; they are never parked on a 
+   * Monitor, so an McsMutex is meant for short critical sections.
+   *
+   * @see Guard
+   *
+   * <b>Scheduling</b>
+   *
+   * Threads competing to acquire() an McsMutex are granted access in FIFO order.
+   *
+   * <b>Error Checking</b>
+   *
+   * No error checking is performed, this means there is the potential for deadlock.
+   * An McsMutex is not interruptable.
+   */
+  class ZTHREAD_API McsMutex : public Lockable, private NonCopyable {
+  public:
+
+    /**
+     * @class Node
+     *
+     * A place in the queue of an McsMutex.
+     */
+    class Node : private NonCopyable {
+
+      friend class McsMutex;
+
+      //! Next thread in the queue
+      Node* volatile _next;
+
+      //! Set when the lock is handed to this node, or when its owner gives up
+      volatile int _state;
+
+      //! Set if the node belongs to the McsMutex rather than to the caller
+      bool _owned;
+
+      //! Keep the nodes of different threads off the same cache line
+      char _pad[64];
+
+    public:
+
+      Node() : _next(0), _state(0), _owned(false) { }
+
+    };
+
+    /**
+     * @class Handle
+     *
+     * The Lockable seen by the locking policies of a Guard<McsMutex>, which 
+     * acquires its McsMutex with the node held by that Guard.
+     */
+    class Handle {
+
+      McsMutex& _mutex;
+      Node* _node;
+
+    public:
+
+      Handle(McsMutex& mutex, Node* node) : _mutex(mutex), _node(node) { }
+
+      void acquire() {
+        _mutex.acquire(*_node);
+      }
+
+      bool tryAcquire(unsigned long timeout) {
+        return _mutex.tryAcquire(*_node, timeout);
+      }
+
+      void release() {
+        _mutex.release();
+      }
+
+    };
+
+  private:
+
+    //! Last node in the queue, 0 while the lock is free
+    Node* volatile _tail;
+
+    //! Node of the thread holding the lock
+    Node* _holder;
+
+    //! Take the lock with the given node if it is free
+    bool grab(Node& node);
+
+    //! Queue an allocated node, giving it up if the timeout expires
+    bool wait(Node* node, unsigned long timeout);
+
+    //! Free a node once the queue no longer refers to it
+    void retire(Node* node);
+
+  public:
+
+    //! Create a new McsMutex.
+    McsMutex(); 
+
+    //! Destroy this McsMutex.
+    virtual ~McsMutex();
+  
+    /**
+     * Acquire the McsMutex, blocking until the threads queued ahead of the caller 
+     * have released it. A node is allocated to queue the caller.
+     *
+     * @pre The calling thread should <i>not</i> have previously acquired this lock.
+     *
+     * @post The calling thread obtains the lock successfully if no exception is thrown.
+     * @exception Interrupted_Exception never thrown
+     *
+     * @see Lockable::acquire()
+     */
+    virtual void acquire();
+
+    /**
+     * Acquire the McsMutex, queuing the caller with the given node. The node must
+     * stay valid until the lock is release()d.
+     *
+     * @param node Node to queue the caller with
+     */
+    void acquire(Node& node);
+
+    /**
+     * Acquire the McsMutex, waiting no longer than the given timeout. A caller 
+     * that has to wait queues on a node allocated for it; if the timeout expires
+     * that node is abandoned in the queue and freed by the thread that would 
+     * have handed the lock to it.
+     *
+     * @param timeout maximum amount of time (milliseconds) to wait
+     *
+     * @return 
+     * - <em>true</em> if the lock was acquired within the timeout.
+     * - <em>false</em> otherwise.
+     *
+     * @see Lockable::tryAcquire(unsigned long timeout)
+     */
+    virtual bool tryAcquire(unsigned long timeout);
+
+    /**
+     * Acquire the McsMutex with the given node if it is free, otherwise behave 
+     * as tryAcquire(unsigned long) does.
+     *
+     * @param node Node used if the lock is free
+     * @param timeout maximum amount of time (milliseconds) to wait
+     */
+    bool tryAcquire(Node& node, unsigned long timeout);
+  
+    /**
+     * Release the McsMutex, handing it to the next thread in the queue.
+     *
+     * @pre the caller should have previously acquired this lock
+     *
+     * @see Lockable::release()
+     */
+    virtual void release();
+
+  }; /* McsMutex */
+
+  /**
+   * @class LockHolder<McsMutex>
+   *
+   * Guards of an McsMutex carry the queue node for the McsMutex. Guards that 
+   * share the scope of another Guard share its node as well.
+   */
+  template <>
+  class LockHolder<McsMutex> {
+
+    McsMutex::Node _node;
+    McsMutex::Handle _handle;
+    bool _enabled;
+
+  public:
+
+    template <class T>
+    LockHolder(T& t) : _handle(extract(t)._handle), _enabled(true) { }
+
+    LockHolder(LockHolder& holder) : _handle(holder._handle), _enabled(true) { }
+
+    LockHolder(McsMutex& lock) : _handle(lock, &_node), _enabled(true) { }
+
+    void disable() { 
+      _enabled = false;
+    }
+
+    bool isDisabled() {
+      return !_enabled;
+    }
+
+    McsMutex::Handle& getLock() {
+      return _handle;
+    }
+
+  protected:
+
+    template <class T>  
+    static LockHolder& extract(T& t) {
+      return (LockHolder&)(t);
+    }
+
+  };
+
+} // namespace ZThread
+
+#endif // __ZTMCSMUTEX_H__
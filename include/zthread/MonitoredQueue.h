@@ -44,6 +44,9 @@ namespace ZThread {
    * - Threads calling the next() methods will be blocked until the BoundedQueue has a value to
    *   return. 
    *
+   * A range of values can be addAll()ed while holding the lock once, waking no more 
+   * blocked threads than there are values.
+   *
    * @see Queue
    */
   template <class T, class LockType, typename StorageType=std::deque<T> >
@@ -64,11 +67,68 @@ namespace ZThread {
       //! Cancellation flag
       volatile bool _canceled;
 
+      //! Number of values stored, readable without the lock
+      volatile size_t _count;
+
+      //! Number of threads blocked in next() that have not been signaled
+      size_t _idle;
+
+      //! Number of threads blocked in next() that have been signaled
+      size_t _signaled;
+
+      //! Block until signaled, counting the calling thread as idle 
+      bool waitNotEmpty(bool timed, unsigned long timeout = 0) {
+
+        bool signaled = true;
+        ++_idle;
+
+        try {
+
+          if(timed)
+            signaled = _notEmpty.wait(timeout);
+          else
+            _notEmpty.wait();
+
+        } catch(...) {
+
+          leaveIdle();
+          throw;
+
+        }
+
+        leaveIdle();
+        return signaled;
+
+      }
+
+      void leaveIdle() {
+
+        if(_signaled > 0)
+          --_signaled;
+        else
+          --_idle;
+
+      }
+
+      //! Wake up to n idle threads
+      void wakeIdle(size_t n) {
+
+        for(; n > 0 && _idle > 0; --n) {
+
+          --_idle;
+          ++_signaled;
+
+          _notEmpty.signal();
+
+        }
+
+      }
+
       public:
 
       //! Create a new MonitoredQueue
       MonitoredQueue() 
-        : _notEmpty(_lock), _isEmpty(_lock), _canceled(false) {}
+        : _notEmpty(_lock), _isEmpty(_lock), _canceled(false), _count(0), _idle(0), _signaled(0) {}
 
       //! Destroy a MonitoredQueue, delete remaining items
       virtual ~MonitoredQueue() { }
@@ -96,8 +156,9 @@ namespace ZThread {
           throw Cancellation_Exception();
 
         _queue.push_back( item );
+        _count = _queue.size();
 
-        _notEmpty.signal(); // Wake one waiter
+        wakeIdle(1); // Wake one waiter
 
       }
 
@@ -132,8 +193,9 @@ namespace ZThread {
             throw Cancellation_Exception();
       
           _queue.push_back(item);
+          _count = _queue.size();
 
-          _notEmpty.signal();
+          wakeIdle(1);
 
         } catch(Timeout_Exception&) { return false; }
  
@@ -141,6 +203,36 @@ namespace ZThread {
 
       }
 
+      /**
+       * Add a range of values to this Queue, holding the lock once and waking 
+       * at most one blocked thread for each value added.
+       *
+       * @param begin first value to be added to the Queue
+       * @param end position after the last value to be added
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       *
+       * @pre  The Queue should not have been canceled prior to the invocation of this function.
+       * @post If no exception is thrown, a copy of each value will have been added to the Queue.
+       */
+      template <class InputIterator>
+      void addAll(InputIterator begin, InputIterator end) {
+
+        Guard<LockType> g(_lock);
+    
+        if(_canceled)
+          throw Cancellation_Exception();
+
+        size_t n = 0;
+        for(; begin != end; ++begin, ++n) 
+          _queue.push_back(*begin);
+
+        _count = _queue.size();
+
+        wakeIdle(n);
+
+      }
+
       /**
        * Retrieve and remove a value from this Queue.
        *
@@ -161,13 +253,14 @@ namespace ZThread {
         Guard<LockType> g(_lock);
       
         while (_queue.size() == 0 && !_canceled) 
-          _notEmpty.wait();
+          waitNotEmpty(false);
     
         if(_queue.size() == 0) // Queue canceled
           throw Cancellation_Exception();  
       
         T item = _queue.front();
         _queue.pop_front();
+        _count = _queue.size();
 
         if(_queue.size() == 0) // Wake empty waiters
           _isEmpty.broadcast();
@@ -199,7 +292,7 @@ namespace ZThread {
         Guard<LockType> g(_lock, timeout);
       
         while(_queue.size() == 0 && !_canceled) {
-          if(!_notEmpty.wait(timeout))
+          if(!waitNotEmpty(true, timeout))
             throw Timeout_Exception();
         }
 
@@ -208,6 +301,7 @@ namespace ZThread {
 
         T item = _queue.front();
         _queue.pop_front();
+        _count = _queue.size();
 
         if(_queue.size() == 0) // Wake empty waiters
           _isEmpty.broadcast();
@@ -249,6 +343,19 @@ namespace ZThread {
       }
 
 
+      /**
+       * Test, without blocking, whether a value appears to be available. The 
+       * answer can be out of date by the time it is returned; it is meant for 
+       * threads that poll briefly before blocking in next().
+       *
+       * @return 
+       *  - <em>true</em> if a value was available.
+       *  - <em>false</em> otherwise.
+       */
+      bool available() const {
+        return _count > 0;
+      }
+
       /**
        * @see Queue::size()
        */
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTPARALLEL_H__
+#define __ZTPARALLEL_H__
+
+#include "zthread/PoolExecutor.h"
+#include "zthread/NonCopyable.h"
+
+#include <vector>
+
+namespace ZThread {
+
+  namespace { class LoopImpl; }
+
+  /**
+   * @class ParallelLoop
+   * @version 2.3.3
+   *
+   * A ParallelLoop runs the iterations of a range in parallel, using the 
+   * threads of a PoolExecutor together with the calling thread. The range is 
+   * handed out in chunks from a shared counter, so threads that get through 
+   * their chunks faster simply take more of them.
+   *
+   * With a grain size of 0 the chunk size is chosen automatically: each thread
+   * starts with a single iteration and doubles its chunk size while a chunk 
+   * takes less than about 100 microseconds, but never takes more than its share
+   * of what remains, so the threads finish together.
+   *
+   * The calling thread works on the range rather than blocking, and returns 
+   * once every iteration has run. Threads of the PoolExecutor that only get to 
+   * the loop after the range is exhausted do not delay the caller.
+   *
+   * This is the base of parallelFor(), parallelReduce() and parallelInvoke().
+   */
+  class ParallelLoop : private NonCopyable {
+
+    LoopImpl* _impl;
+
+  public:
+
+    /**
+     * Create a ParallelLoop over [begin, end)
+     *
+     * @param grain number of iterations in each chunk, 0 to choose automatically
+     */
+    ParallelLoop(size_t begin, size_t end, size_t grain);
+
+    virtual ~ParallelLoop();
+
+    /**
+     * Run every iteration of the range, using the threads of the given 
+     * PoolExecutor and the calling thread.
+     *
+     * @exception Synchronization_Exception thrown if an iteration run by 
+     *            another thread threw; an exception thrown by an iteration the
+     *            calling thread ran is rethrown as is. Once an iteration throws,
+     *            no further chunks are started.
+     */
+    void run(PoolExecutor& executor);
+
+    /**
+     * Run a chunk of iterations.
+     *
+     * @param begin first iteration of the chunk
+     * @param end iteration after the last of the chunk
+     * @param slot number of the calling thread, in [0, slots), 0 for the 
+     *        thread that invoked run(PoolExecutor&). No two threads use 
+     *        the same slot.
+     */
+    virtual void iterate(size_t begin, size_t end, size_t slot) = 0;
+
+  protected:
+
+    /**
+     * Called once, before any iteration runs, with the number of threads that
+     * may work on the range. 
+     *
+     * @param slots threads that may call iterate()
+     */
+    virtual void start(size_t) { }
+
+  }; /* ParallelLoop */
+
+  /**
+   * @class ForLoop
+   * @version 2.3.3
+   *
+   * ParallelLoop calling <i>body(i)</i> for each iteration <i>i</i>.
+   */
+  template <class Body>
+    class ForLoop : public ParallelLoop {
+
+      Body& _body;
+
+    public:
+
+      ForLoop(size_t begin, size_t end, size_t grain, Body& body) 
+        : ParallelLoop(begin, end, grain), _body(body) { }
+
+      virtual void iterate(size_t begin, size_t end, size_t) {
+
+        for(size_t i = begin; i < end; ++i)
+          _body(i);
+
+      }
+
+    }; /* ForLoop */
+
+  /**
+   * @class ReduceLoop
+   * @version 2.3.3
+   *
+   * ParallelLoop combining <i>body(i)</i> for each iteration <i>i</i> into one
+   * partial result per thread; the partial results are combined once the loop
+   * completes, so no lock is taken while the loop runs.
+   */
+  template <class T, class Body, class Combine>
+    class ReduceLoop : public ParallelLoop {
+
+      //! Partial result of a thread, kept off the cache lines of the others
+      struct Partial {
+
+        T value;
+        char pad[64];
+
+        Partial(const T& v) : value(v) { }
+
+      };
+
+      Body& _body;
+      Combine& _combine;
+
+      const T _identity;
+
+      std::vector<Partial> _partials;
+
+    public:
+
+      ReduceLoop(size_t begin, size_t end, size_t grain, const T& identity, Body& body, Combine& combine) 
+        : ParallelLoop(begin, end, grain), _body(body), _combine(combine), _identity(identity) { }
+
+      //! Combine the partial results, in slot order
+      T result() const {
+
+        T value(_identity);
+
+        for(typename std::vector<Partial>::const_iterator i = _partials.begin(); i != _partials.end(); ++i)
+          value = _combine(value, i->value);
+
+        return value;
+
+      }
+
+      virtual void iterate(size_t begin, size_t end, size_t slot) {
+
+        T& value = _partials[slot].value;
+
+        for(size_t i = begin; i < end; ++i)
+          value = _combine(value, _body(i));
+
+      }
+
+    protected:
+
+      virtual void start(size_t slots) {
+        _partials.assign(slots, Partial(_identity));
+      }
+
+    }; /* ReduceLoop */
+
+  /**
+   * Call <i>body(i)</i> for each <i>i</i> in [begin, end), in parallel.
+   *
+   * @param executor PoolExecutor whose threads help the calling thread
+   * @param begin first index
+   * @param end index after the last
+   * @param body function or function object taking a size_t, shared by all
+   *        threads
+   * @param grain number of indices handed out at once, 0 to choose automatically
+   *
+   * @see ParallelLoop
+   */
+  template <class Body>
+    void parallelFor(PoolExecutor& executor, size_t begin, size_t end, Body body, size_t grain = 0) {
+
+      ForLoop<Body> loop(begin, end, grain, body);
+      loop.run(executor);
+
+    }
+
+  /**
+   * Combine <i>body(i)</i> for each <i>i</i> in [begin, end), in parallel. Each
+   * thread combines the values it computes into its own partial result, 
+   * starting from <i>identity</i>, and the partial results are combined when
+   * all the values have been computed. <i>combine</i> must be associative, and 
+   * <i>identity</i> must be its identity.
+   *
+   * @param executor PoolExecutor whose threads help the calling thread
+   * @param begin first index
+   * @param end index after the last
+   * @param identity value such that combine(identity, x) is x
+   * @param body function or function object taking a size_t and returning a T
+   * @param combine function or function object combining two T's into one
+   * @param grain number of indices handed out at once, 0 to choose automatically
+   *
+   * @return the combination of every value computed
+   *
+   * @see ParallelLoop
+   */
+  template <class T, class Body, class Combine>
+    T parallelReduce(PoolExecutor& executor, size_t begin, size_t end, const T& identity, 
+                     Body body, Combine combine, size_t grain = 0) {
+
+      ReduceLoop<T, Body, Combine> loop(begin, end, grain, identity, body, combine);
+      loop.run(executor);
+
+      return loop.result();
+
+    }
+
+  /**
+   * Run a set of tasks in parallel, using the threads of a PoolExecutor 
+   * and the calling thread, and return once all of them have run.
+   *
+   * @param executor PoolExecutor whose threads help the calling thread
+   * @param tasks first of the tasks to run
+   * @param n number of tasks
+   *
+   * @see ParallelLoop
+   */
+  void parallelInvoke(PoolExecutor& executor, const Task* tasks, size_t n);
+
+  //! Run two tasks in parallel
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b);
+
+  //! Run three tasks in parallel
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b, const Task& c);
+
+  //! Run four tasks in parallel
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b, const Task& c, const Task& d);
+
+} // namespace ZThread
+
+#endif // __ZTPARALLEL_H__
@@ -24,13 +24,20 @@
 #define __ZTPOOLEXECUTOR_H__
 
 #include "zthread/Executor.h"
+#include "zthread/CancellationToken.h"
 #include "zthread/CountedPtr.h"
+#include "zthread/ExecutorMetrics.h"
 #include "zthread/Thread.h"
+#include "zthread/Time.h"
+
+#include <vector>
 
 namespace ZThread {
   
   namespace { class ExecutorImpl; }
 
+  class WorkSignal;
+
   /**
    * @class PoolExecutor
    *
@@ -52,11 +59,67 @@ namespace ZThread {
    * - <em>wait</em>()ing on a PoolExecutor will block the calling thread 
    *   until all tasks that were submitted prior to the invocation of this function
    *   have completed.
+   *
+   * <b>Scheduling</b>
+   *
+   * By default every worker draws tasks from a single shared queue. A PoolExecutor
+   * created with the <em>WorkStealing</em> scheduling mode gives each worker its 
+   * own deque instead. Tasks submitted by a worker are pushed onto that worker's 
+   * deque and are run most-recent-first by that worker; tasks submitted by any 
+   * other thread go to a shared injection queue. A worker that runs out of work
+   * steals the oldest task from another worker before it blocks. This removes 
+   * the single queue lock from the path taken by every task, which matters 
+   * most for tasks that spawn further tasks and for large numbers of workers.
+   *
+   * The <em>NodeLocal</em> scheduling mode keeps a queue for each NUMA node 
+   * instead, and spreads the workers over the nodes, binding each to the 
+   * processors of its node. Tasks go to the queue of the node they were 
+   * submitted from, and a worker takes tasks from its own node before it 
+   * takes them from other nodes, nearest first. The nodes are read from 
+   * <em>/sys/devices/system/node</em> on Linux; elsewhere there is one node.
+   *
+   * <b>Sizing</b>
+   *
+   * A PoolExecutor created with a minimum and a maximum number of threads is 
+   * elastic. It starts with the minimum, and adds a thread whenever tasks are 
+   * queued and no thread is idle, or a task waited in the queue longer than 
+   * allowed (see growth()), up to the maximum. A thread above the minimum that 
+   * stays idle for the keep-alive time retires. Optionally the pool can also 
+   * tune itself for throughput (see tuning()).
+   *
+   * <b>Idle workers</b>
+   *
+   * A worker that finds no task blocks until one is submitted, and waking it
+   * costs the submitting thread a system call and the task the scheduler's 
+   * latency. For pipelines where that handoff latency matters, spinning() 
+   * lets a bounded number of idle workers poll the queue for a while first, 
+   * pausing and then yielding the processor between polls, before they block.
+   *
+   * <b>Priorities</b>
+   *
+   * In the <em>SharedQueue</em> scheduling mode tasks can be submitted with a 
+   * Priority, and each Priority has its own queue. Workers take the highest 
+   * priority task first, or with the <em>Weighted</em> policy, serve each 
+   * priority in proportion to its weight. Aging lets a task that has waited 
+   * long enough run next whatever its priority, so that a flood of high 
+   * priority tasks cannot starve the others. The other scheduling modes run
+   * tasks in their usual order whatever their priority.
+   *
+   * <b>Placement</b>
+   *
+   * Workers run on any processor by default. placement() binds them to a given
+   * set of processors, spreads them one per processor, or one NUMA node each.
    * 
    * @see Executor.
    */
   class PoolExecutor : public Executor {
 
+    //! TaskGroups block on the executor's WorkSignal while they help
+    friend class TaskGroup;
+
+    //! Notified when tasks are queued
+    CountedPtr< WorkSignal > _work;
+
     //! Reference to the internal implementation 
     CountedPtr< ExecutorImpl > _impl;
     
@@ -64,6 +127,76 @@ namespace ZThread {
     Task _shutdown;
 
   public:
+
+    //! Task scheduling modes
+    typedef enum {
+
+      //! All workers draw from a single queue
+      SharedQueue,
+
+      //! Each worker owns a deque and steals from the others when idle
+      WorkStealing,
+
+      //! Each NUMA node has a queue, workers prefer their own node's queue
+      NodeLocal
+
+    } Scheduling;
+
+    //! Worker placement modes
+    typedef enum {
+
+      //! Workers run on any processor (or, for NodeLocal, on their node)
+      Floating,
+
+      //! Each worker is bound to one processor, round robin
+      PerCore,
+
+      //! Each worker is bound to the processors of one NUMA node, round robin
+      PerNode,
+
+      //! Every worker is bound to the same set of processors
+      CpuSet
+
+    } Placement;
+
+    //! Orders in which tasks of different priorities are run
+    typedef enum {
+
+      //! Tasks of higher priority always run first
+      Strict,
+
+      //! Each priority gets a share of the workers' time, according to its weight
+      Weighted
+
+    } PriorityPolicy;
+
+    //! What happens to a task whose deadline passed before it started
+    typedef enum {
+
+      //! The task runs anyway, and is counted as missing its deadline
+      RunLate,
+
+      //! The task is dropped without running
+      DropExpired
+
+    } ExpiryPolicy;
+
+    //! What happens to a task submitted while the queue is full
+    typedef enum {
+
+      //! The submitting thread waits for room
+      Block,
+
+      //! The submitting thread runs the task itself
+      CallerRuns,
+
+      //! The task is refused with an Overflow_Exception
+      Reject,
+
+      //! The task that has waited longest is dropped to make room
+      DiscardOldest
+
+    } OverflowPolicy;
     
     /**
      * Create a PoolExecutor
@@ -72,6 +205,30 @@ namespace ZThread {
      */
     PoolExecutor(size_t n);
 
+    /**
+     * Create a PoolExecutor using the given scheduling mode
+     *
+     * @param n number of threads to service tasks with
+     * @param scheduling how tasks are distributed among the threads
+     */
+    PoolExecutor(size_t n, Scheduling scheduling);
+
+    /**
+     * Create an elastic PoolExecutor, which adds threads as the load grows and 
+     * retires idle ones as it drops.
+     *
+     * @param minimum number of threads kept even when idle
+     * @param maximum number of threads the pool may grow to
+     * @param keepAlive time, in milliseconds, a thread above the minimum can stay 
+     *        idle before it retires; 0 keeps every thread that was started
+     * @param scheduling how tasks are distributed among the threads
+     *
+     * @exception InvalidOp_Exception thrown if <i>minimum</i> is less than 1, or 
+     *            <i>maximum</i> is less than <i>minimum</i>.
+     */
+    PoolExecutor(size_t minimum, size_t maximum, unsigned long keepAlive, 
+                 Scheduling scheduling = SharedQueue);
+
     //! Destroy a PoolExecutor
     virtual ~PoolExecutor();
 
@@ -84,6 +241,8 @@ namespace ZThread {
      *       run in the context of an interrupted thread. 
      * @post Any thread already executing a task which was submitted prior to the 
      *       invocation of this function will be interrupted.        
+     *
+     * @see CancellationToken, to cancel some tasks without disturbing the others
      */
     virtual void interrupt();
 
@@ -95,8 +254,13 @@ namespace ZThread {
      * @pre  <i>n</i> must be greater than 0.
      * @post <i>n</i> threads will be executing tasks submitted to this executor.
      *
+     * Threads in excess of the new number retire once they finish their current 
+     * task. For an elastic PoolExecutor this sets the current number of threads, 
+     * which goes on changing with the load.
+     *
      * @exception InvalidOp_Exception thrown if the new number of threads
-     *            <i>n</i> is less than 1.
+     *            <i>n</i> is less than 1, or for an elastic PoolExecutor, 
+     *            outside its minimum and maximum.
      */
     void size(size_t n);
         
@@ -106,6 +270,64 @@ namespace ZThread {
      * @return n number of worker threads.
      */
     size_t size();
+
+    /**
+     * Set when an elastic PoolExecutor adds a thread. A thread is added when no
+     * thread is idle and either <i>backlog</i> tasks are queued, or a task has 
+     * waited <i>age</i> milliseconds in the queue. The defaults are 1 task and
+     * 10 milliseconds. Has no effect on a PoolExecutor of fixed size.
+     *
+     * @param backlog queued tasks that cause a thread to be added
+     * @param age time, in milliseconds, a task may wait before a thread is added;
+     *        0 disables this test
+     */
+    void growth(size_t backlog, unsigned long age);
+
+    /**
+     * Enable or disable tuning. A tuned elastic PoolExecutor measures the rate 
+     * at which it completes tasks, and moves its number of threads one step at 
+     * a time towards the number that gives the highest rate, within its minimum
+     * and maximum. This suits tasks that block, where the best number of 
+     * threads is not known in advance. Has no effect on a PoolExecutor of fixed 
+     * size.
+     *
+     * @param enabled true to tune the number of threads
+     */
+    void tuning(bool enabled);
+
+    /**
+     * Set how long an idle worker polls for a task before it blocks. The worker 
+     * polls <i>spins</i> times with a processor pause between each poll, then 
+     * <i>yields</i> times yielding the processor between each poll, and then 
+     * blocks. Tasks found while polling are handed over without waking a 
+     * blocked thread. The default is to block right away.
+     *
+     * @param spins polls made, pausing between each
+     * @param yields polls made, yielding between each
+     * @param spinners number of workers that may poll at the same time, other
+     *        idle workers block right away
+     */
+    void spinning(size_t spins, size_t yields, size_t spinners = 1);
+
+    /**
+     * Set where workers run. Workers that are running move before they take 
+     * their next task. Binding is a no-op on systems that do not support it.
+     *
+     * @param placement Floating, PerCore or PerNode
+     *
+     * @exception InvalidOp_Exception thrown for CpuSet, which takes the set of 
+     *            processors; see placement(const std::vector<size_t>&).
+     */
+    void placement(Placement placement);
+
+    /**
+     * Bind every worker to the given set of processors.
+     *
+     * @param cpus processor numbers
+     *
+     * @exception InvalidOp_Exception thrown if <i>cpus</i> is empty.
+     */
+    void placement(const std::vector<size_t>& cpus);
     
     /**
      * Submit a task to this Executor. 
@@ -126,6 +348,201 @@ namespace ZThread {
      */
     virtual void execute(const Task& task);
 
+    /**
+     * Submit a task to this Executor with the given priority. Tasks submitted
+     * without a priority are Medium priority.
+     *
+     * @param task Task to be run by a thread managed by this executor 
+     * @param priority priority of the task
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     *
+     * @see PoolExecutor::priorities(PriorityPolicy policy, size_t aging, size_t burst)
+     */
+    void execute(const Task& task, Priority priority);
+
+    /**
+     * Submit a task to this Executor, bound to a CancellationToken. When the 
+     * token is canceled, the task is dropped if it has not started, and the 
+     * thread running it is interrupted if it has; the executor's other tasks 
+     * are not disturbed. A dropped task counts as completed for wait().
+     *
+     * @param task Task to be run by a thread managed by this executor 
+     * @param token CancellationToken the task can be canceled with
+     * @param priority priority of the task
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     *
+     * @see PoolExecutor::interrupt()
+     */
+    void execute(const Task& task, const CancellationToken& token, Priority priority = Medium);
+
+    /**
+     * Set the order in which tasks of different priorities are run. The default
+     * is Strict, without aging, with a burst of 8.
+     *
+     * Tasks with a deadline run ahead of every priority, but no more than 
+     * <i>burst</i> of them in a row while tasks without a deadline are queued;
+     * then one of those runs, chosen by the policy, so a steady stream of 
+     * deadlines can't starve the priorities.
+     *
+     * @param policy Strict or Weighted
+     * @param aging number of tasks that may be started ahead of a queued task
+     *        before it runs next, whatever its priority; 0 disables aging
+     * @param burst most tasks with a deadline run in a row while tasks without
+     *        one are queued; 0 lets them always run first
+     */
+    void priorities(PriorityPolicy policy, size_t aging = 0, size_t burst = 8);
+
+    /**
+     * Set the share of each priority under the Weighted policy. The defaults
+     * are 1, 2 and 4.
+     *
+     * @param low weight of Low priority tasks
+     * @param medium weight of Medium priority tasks
+     * @param high weight of High priority tasks
+     */
+    void weights(size_t low, size_t medium, size_t high);
+
+    /**
+     * Bound the number of tasks waiting in the queue, so that producers that 
+     * outrun the workers are held back instead of growing the queue without 
+     * limit. The default is no bound.
+     *
+     * - <em>Block</em> makes the submitting thread wait for room, for at most 
+     *   the timeout, after which a Timeout_Exception is thrown. A task that 
+     *   submits to its own executor under this policy can wait forever.
+     * - <em>CallerRuns</em> runs the task on the submitting thread.
+     * - <em>Reject</em> throws an Overflow_Exception.
+     * - <em>DiscardOldest</em> drops the task that has waited longest, whatever
+     *   its priority or deadline, which counts as completed for wait(). The 
+     *   work stealing and node local schedulings keep no order between their 
+     *   queues, and drop the task at the front of one of them instead. The 
+     *   Future of a dropped submit()ted task is canceled.
+     *
+     * A batch is admitted as a whole; a batch larger than the capacity is 
+     * admitted once the queue is empty. Rejected and discarded tasks are 
+     * counted in ExecutorMetrics. Tasks submitted to a canceled executor are
+     * refused with a Cancellation_Exception under every policy, and threads
+     * blocked waiting for room throw one when the executor is canceled.
+     *
+     * @param n most tasks that may wait in the queue, 0 for no bound
+     * @param policy what happens to a task submitted while the queue is full
+     * @param timeout longest time, in milliseconds, to Block for; 0 for no limit
+     */
+    void capacity(size_t n, OverflowPolicy policy = Block, unsigned long timeout = 0);
+
+    /**
+     * Submit a task to this Executor with a deadline. With the SharedQueue 
+     * scheduling, tasks with a deadline are run earliest deadline first, ahead
+     * of tasks without one, up to the burst set by priorities(); priority aging
+     * still applies to the latter. The other schedulings run them in their 
+     * usual order.
+     *
+     * Tasks that complete after their deadline are counted in 
+     * ExecutorMetrics::missed.
+     *
+     * @param task Task to be run by a thread managed by this executor 
+     * @param deadline Time the task should complete by
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     *
+     * @see PoolExecutor::expiry()
+     */
+    void execute(const Task& task, const Time& deadline);
+
+    /**
+     * Set what happens to a task whose deadline passed before a thread could 
+     * start it. The default is RunLate.
+     *
+     * Under DropExpired the task is dropped, counted in 
+     * ExecutorMetrics::expired, and passed to the handler, if one is given. 
+     * The handler is called by the thread that drew the task; exceptions it 
+     * throws are ignored. A dropped task counts as completed for wait().
+     *
+     * @param policy RunLate or DropExpired
+     * @param handler function called with each task that is dropped, or 0
+     * @param argument argument passed to the handler
+     */
+    void expiry(ExpiryPolicy policy, void (*handler)(const Task& task, void* argument) = 0, 
+                void* argument = 0);
+
+    /**
+     * Submit a batch of tasks to this Executor. The whole batch is queued while
+     * holding the queue's lock once, and no more worker threads are woken than 
+     * there are tasks in the batch. The batch is counted as a single group of 
+     * tasks for the purposes of wait().
+     *
+     * @param tasks first of the tasks to submit
+     * @param n number of tasks
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function; no task in the batch is submitted.
+     *
+     * @see PoolExecutor::execute(const Task& task)
+     */
+    void executeBatch(const Task* tasks, size_t n);
+
+    /**
+     * Submit a range of tasks to this Executor as a single batch.
+     *
+     * @param begin first of the tasks to submit, Tasks or Runnable pointers
+     * @param end position after the last task
+     *
+     * @see PoolExecutor::executeBatch(const Task* tasks, size_t n)
+     */
+    template <class InputIterator>
+    void executeAll(InputIterator begin, InputIterator end) {
+
+      std::vector<Task> batch(begin, end);
+
+      if(!batch.empty())
+        executeBatch(&batch[0], batch.size());
+
+    }
+
+    /**
+     * Submit a function to this Executor. The function and its argument are
+     * queued in place of a Task, so unlike execute(const Task&), this does not 
+     * allocate anything beyond the queue's own storage.
+     * 
+     * @param function function to be run by a thread managed by this executor
+     * @param argument argument passed to the function
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     *
+     * @see PoolExecutor::execute(const Task& task)
+     */
+    void execute(void (*function)(void*), void* argument);
+
+    /**
+     * Take one task from the queue and run it on the calling thread, rather 
+     * than on a thread of this executor. A thread waiting for some tasks of 
+     * this executor to complete can use this to help, instead of blocking.
+     *
+     * @return 
+     *   - <em>true</em> if a task was run.
+     *   - <em>false</em> if no task was queued.
+     *
+     * @see TaskGroup
+     */
+    bool runQueued();
+
+    /**
+     * Take a snapshot of the metrics collected by this executor: the tasks 
+     * submitted and completed, the depth of the queue, how long tasks waited 
+     * and ran, and how busy each worker has been. Collecting them costs each 
+     * task a few clock reads; compiling the library with 
+     * ZTHREAD_DISABLE_METRICS removes them.
+     *
+     * @return ExecutorMetrics the current metrics
+     */
+    ExecutorMetrics metrics();
+
     /**
      * @see Cancelable::cancel()
      */
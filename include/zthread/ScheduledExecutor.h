@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSCHEDULEDEXECUTOR_H__
+#define __ZTSCHEDULEDEXECUTOR_H__
+
+#include "zthread/Executor.h"
+#include "zthread/CountedPtr.h"
+
+namespace ZThread {
+  
+  namespace { class SchedulerImpl; class TimerEntry; }
+
+  /**
+   * @class ScheduledTask
+   * @version 2.3.3
+   *
+   * A handle to a task submitted to a ScheduledExecutor. ScheduledTasks may 
+   * be freely copied; each copy refers to the same task.
+   *
+   * - <em>cancel</em>()ing a ScheduledTask prevents any run of the task that 
+   *   has not already started. A periodic task is not run again once canceled. 
+   *
+   * @see ScheduledExecutor
+   */
+  class ScheduledTask : public Cancelable {
+
+    //! Scheduler the task was submitted to
+    CountedPtr< SchedulerImpl > _impl;
+
+    //! Timer for the task
+    TimerEntry* _entry;
+
+  public:
+
+    //! Create a handle for the given timer
+    ScheduledTask(const CountedPtr< SchedulerImpl >& impl, TimerEntry* entry);
+
+    //! Copy a handle
+    ScheduledTask(const ScheduledTask& task);
+
+    //! Destroy a handle, the task remains scheduled
+    virtual ~ScheduledTask();
+
+    //! Assign a handle
+    const ScheduledTask& operator=(const ScheduledTask& task);
+
+    /**
+     * Cancel the task. This takes constant time, regardless of the number
+     * of tasks that are scheduled.
+     *
+     * @post the task will not be started again.
+     *
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+
+    /**
+     * Test whether the task has finished. A periodic task is only done once 
+     * it has been canceled, or once a run has thrown an exception. 
+     *
+     * @return true if the task will not be run again.
+     */
+    bool isDone();
+
+  }; /* ScheduledTask */
+
+  /**
+   * @class ScheduledExecutor
+   * @version 2.3.3
+   *
+   * A ScheduledExecutor runs tasks after a delay, or periodically. Pending 
+   * tasks are kept by a single timer thread in a hierarchical timer wheel, 
+   * so scheduling and canceling a task take constant time and hundreds of 
+   * thousands of tasks can be pending without a thread for each. Tasks 
+   * that become due are handed to a PoolExecutor to be run.
+   *
+   * - <em>schedule</em>()ing a task runs it once after the given delay.
+   *
+   * - <em>scheduleAtFixedRate</em>() runs a task periodically, each run
+   *   starting one period after the previous run was due. 
+   *
+   * - <em>scheduleWithFixedDelay</em>() runs a task periodically, each run
+   *   starting a fixed delay after the previous run finished.
+   *
+   * A periodic task never runs concurrently with itself; a run that takes
+   * longer than its period delays the next run. A periodic task that throws 
+   * an exception is not run again.
+   *
+   * - <em>cancel</em>()ing a ScheduledExecutor causes it to stop accepting 
+   *   new tasks and discards all tasks that are not yet due. 
+   *
+   * - <em>interrupt</em>()ing a ScheduledExecutor interrupts the tasks that 
+   *   are being run by its PoolExecutor.
+   *
+   * - <em>wait</em>()ing on a ScheduledExecutor will block the calling thread 
+   *   until all tasks that became due prior to the invocation of this function 
+   *   have completed.
+   *
+   * Delays have a resolution of one millisecond.
+   *
+   * @see PoolExecutor
+   */
+  class ScheduledExecutor : public Executor {
+
+    //! Reference to the internal implementation 
+    CountedPtr< SchedulerImpl > _impl;
+
+    //! Cancellation task
+    Task _shutdown;
+
+  public:
+
+    /**
+     * Create a ScheduledExecutor
+     *
+     * @param n number of threads used to run tasks that are due
+     */
+    ScheduledExecutor(size_t n);
+
+    //! Destroy a ScheduledExecutor
+    virtual ~ScheduledExecutor();
+
+    /**
+     * Run a task once after a delay.
+     *
+     * @param task Task to run
+     * @param delay milliseconds to wait before running the task
+     *
+     * @return handle to the scheduled task
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     */
+    ScheduledTask schedule(const Task& task, unsigned long delay);
+
+    /**
+     * Run a task periodically, at a fixed rate.
+     *
+     * @param task Task to run
+     * @param initialDelay milliseconds to wait before the first run
+     * @param period milliseconds between the times each run is due
+     *
+     * @return handle to the scheduled task
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     * @exception InvalidOp_Exception thrown if the <i>period</i> is 0.
+     */
+    ScheduledTask scheduleAtFixedRate(const Task& task, unsigned long initialDelay, 
+                                      unsigned long period);
+
+    /**
+     * Run a task periodically, with a fixed delay between runs.
+     *
+     * @param task Task to run
+     * @param initialDelay milliseconds to wait before the first run
+     * @param delay milliseconds between the end of one run and the start of the next
+     *
+     * @return handle to the scheduled task
+     *
+     * @exception Cancellation_Exception thrown if the Executor was canceled prior to
+     *            the invocation of this function.
+     * @exception InvalidOp_Exception thrown if the <i>delay</i> is 0.
+     */
+    ScheduledTask scheduleWithFixedDelay(const Task& task, unsigned long initialDelay, 
+                                         unsigned long delay);
+
+    /**
+     * Interrupt the tasks being run by the PoolExecutor.
+     *
+     * @see PoolExecutor::interrupt()
+     */
+    virtual void interrupt();
+
+    /**
+     * Submit a task to be run without delay.
+     *
+     * @see Executor::execute(const Task& task)
+     */
+    virtual void execute(const Task& task);
+
+    /**
+     * Stop accepting tasks, discarding any task that is not yet due.
+     *
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+ 
+    /**
+     * Block the calling thread until all tasks that became due prior to this 
+     * invocation complete.
+     *
+     * @see Waitable::wait()
+     */
+    virtual void wait();
+
+    /**
+     * Block the calling thread until all tasks that became due prior to this 
+     * invocation complete, or until the timeout expires.
+     *
+     * @see Waitable::wait(unsigned long timeout)
+     */
+    virtual bool wait(unsigned long timeout);
+
+  }; /* ScheduledExecutor */
+
+} // namespace ZThread
+
+#endif // __ZTSCHEDULEDEXECUTOR_H__
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSERIALEXECUTOR_H__
+#define __ZTSERIALEXECUTOR_H__
+
+#include "zthread/Executor.h"
+#include "zthread/CountedPtr.h"
+
+namespace ZThread {
+
+  namespace { class SerialImpl; }
+
+  /**
+   * @class SerialExecutor
+   * @version 2.3.3
+   *
+   * A SerialExecutor (sometimes called a strand) runs the tasks submitted to it 
+   * one at a time, in the order they were submitted, using the threads of some 
+   * other Executor. Unlike a ConcurrentExecutor it owns no thread, so a program 
+   * can have thousands of independently ordered streams of tasks, one for each
+   * connection or account, sharing a single PoolExecutor.
+   *
+   * Tasks are queued in a lock-free inbox. The SerialExecutor submits itself to 
+   * the underlying Executor only when a task arrives at an empty inbox, and then
+   * runs queued tasks until the inbox is empty again; after a number of tasks 
+   * it resubmits itself instead, so that one busy stream cannot monopolize a 
+   * thread of a shared Executor. A pending task costs its memory only.
+   *
+   * - <em>cancel</em>()ing a SerialExecutor will cause it to stop accepting 
+   *   new tasks. Tasks already submitted still run.
+   *
+   * - <em>interrupt</em>()ing a SerialExecutor will cause the thread running 
+   *   each task which was submitted prior to the invocation of this function to
+   *   be interrupted during the execution of that task.
+   *
+   * - <em>wait</em>()ing on a SerialExecutor will block the calling thread 
+   *   until all tasks that were submitted prior to the invocation of this function
+   *   have completed.
+   *
+   * The underlying Executor must outlive the tasks submitted to the 
+   * SerialExecutor. If it refuses the SerialExecutor, by throwing from its 
+   * execute(), the SerialExecutor is canceled and the tasks that were queued 
+   * are discarded.
+   *
+   * @see Executor.
+   */
+  class SerialExecutor : public Executor {
+  
+    CountedPtr< SerialImpl > _impl;
+
+  public:
+
+    /**
+     * Create a new SerialExecutor
+     *
+     * @param executor Executor whose threads run the tasks
+     */
+    SerialExecutor(Executor& executor);
+
+    //! Destroy a SerialExecutor, tasks already submitted still run
+    virtual ~SerialExecutor();
+
+    /**
+     * @see Executor::interrupt()
+     */
+    virtual void interrupt();
+    
+    /**
+     * Submit a task to this Executor. This never blocks the calling thread, and
+     * never runs the task in the calling thread.
+     * 
+     * @exception Cancellation_Exception thrown if this Executor has been canceled,
+     *            or if the underlying Executor refused it.
+     *
+     * @see Executor::execute(const Task&)
+     */
+    virtual void execute(const Task&);
+
+    /**
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+  
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+ 
+    /**
+     * @see Waitable::wait()
+     */
+    virtual void wait();
+
+    /**
+     * @see Waitable::wait(unsigned long timeout)
+     */
+    virtual bool wait(unsigned long timeout);
+
+  }; /* SerialExecutor */
+
+} // namespace ZThread
+
+#endif // __ZTSERIALEXECUTOR_H__
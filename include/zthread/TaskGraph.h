@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTASKGRAPH_H__
+#define __ZTTASKGRAPH_H__
+
+#include "zthread/Cancelable.h"
+#include "zthread/CountedPtr.h"
+#include "zthread/NonCopyable.h"
+#include "zthread/PoolExecutor.h"
+#include "zthread/Waitable.h"
+
+namespace ZThread {
+
+  namespace { class GraphImpl; }
+
+  /**
+   * @class TaskGraph
+   * @version 2.3.3
+   *
+   * A TaskGraph runs a set of tasks whose dependencies form a directed acyclic 
+   * graph. Each node counts its unfinished predecessors, and the thread that 
+   * completes the last of them submits the node to a PoolExecutor; no lock is 
+   * held and no thread waits between stages. The thread that releases 
+   * successors keeps one of them and runs it directly.
+   *
+   * A graph is built once and may be executed any number of times. Everything
+   * a run needs is allocated while the graph is built, so executing it again 
+   * does not allocate.
+   *
+   * @code
+   *
+   * TaskGraph graph;
+   *
+   * TaskGraph::Node load  = graph.add(new Load);
+   * TaskGraph::Node left  = graph.add(new Transform(0));
+   * TaskGraph::Node right = graph.add(new Transform(1));
+   * TaskGraph::Node store = graph.add(new Store);
+   *
+   * graph.depends(left, load);
+   * graph.depends(right, load);
+   * graph.depends(store, left);
+   * graph.depends(store, right);
+   *
+   * for(int day = 0; day < 7; ++day)
+   *   graph.run(executor);
+   *
+   * @endcode
+   *
+   * - <em>cancel</em>()ing a TaskGraph will cause the nodes of the current 
+   *   run that have not yet started to be skipped. The next run clears it.
+   *
+   * - A node dropped by the executor without running, for instance under the
+   *   DiscardOldest overflow policy, cancels the current run in the same way.
+   *
+   * The graph can't be changed while it is running. A TaskGraph waits for the 
+   * current run when it is destroyed.
+   */
+  class TaskGraph : public Cancelable, public Waitable, private NonCopyable {
+
+    CountedPtr< GraphImpl > _impl;
+
+  public:
+
+    //! Identifies a node of the graph
+    typedef size_t Node;
+
+    //! Create an empty TaskGraph
+    TaskGraph();
+
+    //! Destroy a TaskGraph, waiting for the current run to complete
+    virtual ~TaskGraph();
+
+    /**
+     * Add a node to the graph.
+     *
+     * @param task Task the node runs
+     *
+     * @return Node the new node
+     *
+     * @exception InvalidOp_Exception thrown if the graph is running.
+     */
+    Node add(const Task& task);
+
+    /**
+     * Make one node wait for another. A node starts once all of its 
+     * predecessors have completed.
+     *
+     * @param node Node that waits
+     * @param predecessor Node that must complete first
+     *
+     * @exception InvalidOp_Exception thrown if the graph is running, if either
+     *            node does not exist, or if the dependency would form a cycle.
+     */
+    void depends(Node node, Node predecessor);
+
+    /**
+     * Start a run of the graph, submitting the nodes without predecessors to 
+     * the given executor. Returns without waiting for the run to complete.
+     *
+     * @param executor PoolExecutor that runs the nodes
+     *
+     * @exception InvalidOp_Exception thrown if the graph is already running.
+     * @exception Cancellation_Exception thrown if the executor has been 
+     *            canceled.
+     */
+    void execute(PoolExecutor& executor);
+
+    /**
+     * Run the graph on the given executor and wait for it to complete.
+     *
+     * @param executor PoolExecutor that runs the nodes
+     *
+     * @see TaskGraph::execute(PoolExecutor&)
+     * @see TaskGraph::wait()
+     */
+    void run(PoolExecutor& executor);
+
+    /**
+     * Wait for the current run to complete. Returns immediately if the graph 
+     * is not running.
+     *
+     * @exception Synchronization_Exception thrown if a node threw an exception;
+     *            the nodes that depend on it, directly or not, are skipped. 
+     * @exception Interrupted_Exception thrown if the calling thread is 
+     *            interrupted while waiting.
+     */
+    virtual void wait();
+
+    /**
+     * Wait for the current run to complete, or for the timeout to expire.
+     *
+     * @param timeout maximum amount of time, in milliseconds, to wait
+     *
+     * @return 
+     *   - <em>true</em> if the run completed in time.
+     *   - <em>false</em> otherwise.
+     *
+     * @see TaskGraph::wait()
+     */
+    virtual bool wait(unsigned long timeout);
+
+    /**
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+
+    //! @return size_t number of nodes in the graph
+    size_t size();
+
+  }; /* TaskGraph */
+
+} // namespace ZThread
+
+#endif // __ZTTASKGRAPH_H__
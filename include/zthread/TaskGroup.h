@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTASKGROUP_H__
+#define __ZTTASKGROUP_H__
+
+#include "zthread/Cancelable.h"
+#include "zthread/CountedPtr.h"
+#include "zthread/NonCopyable.h"
+#include "zthread/PoolExecutor.h"
+#include "zthread/Waitable.h"
+
+namespace ZThread {
+
+  namespace { class GroupImpl; }
+
+  /**
+   * @class TaskGroup
+   * @version 2.3.3
+   *
+   * A TaskGroup submits tasks to a PoolExecutor and keeps track of them, and 
+   * only them, so that a thread can wait for the tasks it forked without 
+   * waiting for everything else the executor is running.
+   *
+   * A thread wait()ing on a TaskGroup runs tasks queued in the executor until
+   * the group completes, and only blocks when there is nothing left to run. 
+   * A task running on a thread of the executor can therefore fork tasks into a
+   * TaskGroup of its own and wait for them without holding up a thread, which 
+   * makes recursive divide and conquer practical on a pool of any size.
+   *
+   * @code
+   *
+   * void Sort::run() {
+   *
+   *   if(small()) 
+   *     return sortInPlace();
+   *
+   *   TaskGroup group(executor);
+   *
+   *   group.run(new Sort(lowerHalf()));
+   *   group.run(new Sort(upperHalf()));
+   *
+   *   group.wait();
+   *   merge();
+   *
+   * }
+   *
+   * @endcode
+   *
+   * - <em>cancel</em>()ing a TaskGroup will cause the tasks that have not yet
+   *   started to be skipped, and the group to stop accepting new tasks.
+   *
+   * A TaskGroup waits for its tasks when it is destroyed.
+   */
+  class TaskGroup : public Cancelable, public Waitable, private NonCopyable {
+
+    PoolExecutor& _executor;
+
+    CountedPtr< GroupImpl > _impl;
+
+  public:
+
+    /**
+     * Create a TaskGroup
+     *
+     * @param executor PoolExecutor that runs the tasks
+     */
+    TaskGroup(PoolExecutor& executor);
+
+    //! Destroy a TaskGroup, waiting for its tasks to complete
+    virtual ~TaskGroup();
+
+    /**
+     * Submit a task to the executor as a member of this group.
+     *
+     * @param task Task to run
+     *
+     * @exception Cancellation_Exception thrown if this group or the executor 
+     *            has been canceled.
+     */
+    void run(const Task& task);
+
+    /**
+     * Run queued tasks on the calling thread until every task submitted to 
+     * this group has completed. While nothing is queued the calling thread 
+     * blocks until a task is queued to the executor or the group completes.
+     *
+     * @exception Synchronization_Exception thrown if a task of this group threw
+     *            an exception. 
+     */
+    virtual void wait();
+
+    /**
+     * Run queued tasks on the calling thread until every task submitted to 
+     * this group has completed, or until the timeout expires. The timeout is
+     * checked between tasks, so a long task run by the calling thread can 
+     * delay the return.
+     *
+     * @param timeout maximum amount of time, in milliseconds, to wait
+     *
+     * @return 
+     *   - <em>true</em> if the tasks completed in time.
+     *   - <em>false</em> otherwise.
+     *
+     * @exception Synchronization_Exception thrown if a task of this group threw
+     *            an exception. 
+     */
+    virtual bool wait(unsigned long timeout);
+
+    /**
+     * @see Cancelable::cancel()
+     */
+    virtual void cancel();
+
+    /**
+     * @see Cancelable::isCanceled()
+     */
+    virtual bool isCanceled();
+
+  }; /* TaskGroup */
+
+} // namespace ZThread
+
+#endif // __ZTTASKGROUP_H__
@@ -50,6 +50,11 @@ namespace ZThread {
    * - <em>wait</em>()ing on a ThreadedExecutor will block the calling thread 
    *   until all tasks that were submitted prior to the invocation of this function
    *   have completed.
+   *
+   * A ThreadedExecutor can also cache its threads. A cached thread that finishes
+   * its task waits for a while to be handed the next task submitted, sparing 
+   * that task the cost of creating a thread. Tasks are still never queued; 
+   * a task submitted while no thread is waiting gets a new thread.
    * 
    * @see Executor.
    */
@@ -62,6 +67,14 @@ namespace ZThread {
     //! Create a new ThreadedExecutor
     ThreadedExecutor();
 
+    /**
+     * Create a new ThreadedExecutor that caches its threads.
+     *
+     * @param keepAlive time, in milliseconds, a thread that finished its task
+     *        waits to be reused before it exits; 0 disables caching
+     */
+    explicit ThreadedExecutor(unsigned long keepAlive);
+
     //! Destroy a ThreadedExecutor
     virtual ~ThreadedExecutor();
 
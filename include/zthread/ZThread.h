@@ -28,24 +28,32 @@
 #include "zthread/BiasedReadWriteLock.h"
 #include "zthread/BlockingQueue.h"
 #include "zthread/BoundedQueue.h"
+#include "zthread/Callable.h"
+#include "zthread/CancellationToken.h"
 #include "zthread/Cancelable.h"
 #include "zthread/ClassLockable.h"
 #include "zthread/ConcurrentExecutor.h"
 #include "zthread/Condition.h"
 #include "zthread/Config.h"
+#include "zthread/Coroutines.h"
 #include "zthread/CountedPtr.h"
 #include "zthread/CountingSemaphore.h"
 #include "zthread/Exceptions.h"
 #include "zthread/Executor.h"
+#include "zthread/ExecutorMetrics.h"
 #include "zthread/FairReadWriteLock.h"
 #include "zthread/FastMutex.h"
 #include "zthread/FastRecursiveMutex.h"
+#include "zthread/Future.h"
+#include "zthread/FutureTask.h"
 #include "zthread/Guard.h"
 #include "zthread/Lockable.h"
 #include "zthread/LockedQueue.h"
+#include "zthread/McsMutex.h"
 #include "zthread/MonitoredQueue.h"
 #include "zthread/Mutex.h"
 #include "zthread/NonCopyable.h"
+#include "zthread/Parallel.h"
 #include "zthread/PoolExecutor.h"
 #include "zthread/Priority.h"
 #include "zthread/PriorityCondition.h"
@@ -56,9 +64,13 @@
 #include "zthread/ReadWriteLock.h"
 #include "zthread/RecursiveMutex.h"
 #include "zthread/Runnable.h"
+#include "zthread/ScheduledExecutor.h"
 #include "zthread/Semaphore.h"
+#include "zthread/SerialExecutor.h"
 #include "zthread/Singleton.h"
 #include "zthread/SynchronousExecutor.h"
+#include "zthread/TaskGraph.h"
+#include "zthread/TaskGroup.h"
 #include "zthread/Thread.h"
 #include "zthread/ThreadLocal.h"
 #include "zthread/Time.h"
@@ -19,7 +19,7 @@ dnl CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 dnl
 dnl Enables AM_ENABLE_ATOMIC_GCC to test for 
-dnl GCC's atomic instruction support.
+dnl GCC's atomic builtins.
 dnl
 dnl --enable-atomic-gcc=yes|no [default=no]
 dnl
@@ -29,8 +29,8 @@ dnl
 ifdef(AM_ENABLE_ATOMIC_GCC,,[
 
 ATOMIC_GCC_ERROR=<<"EOF"
-This compiler does not support the __atomic_add() and
-__exchange_and_add() functions.
+This compiler does not provide the __sync_fetch_and_add() and
+__sync_bool_compare_and_swap() builtins.
 EOF
 
 atomic_gcc_explicit="no"
@@ -44,18 +44,17 @@ AC_DEFUN(AM_ENABLE_ATOMIC_GCC,
 
  if test $enable_atomic_gcc = "yes"; then
 
- AC_CHECK_HEADER([bits/atomicity.h],
- [ AC_MSG_CHECKING([for __atomic_add(), __exchange_and_add() support])
+   AC_MSG_CHECKING([for __sync_fetch_and_add(), __sync_bool_compare_and_swap() support])
 
-   AC_TRY_LINK([#include <bits/atomicity.h>],
+   AC_TRY_LINK([],
    [
-      _Atomic_word i(0); 
-      __atomic_add(&i, 1); 
-      __exchange_and_add(&i, 1); 
+      unsigned int i = 0; 
+      __sync_fetch_and_add(&i, 1); 
+      __sync_bool_compare_and_swap(&i, 1, 0); 
 
    ],
    [ AC_MSG_RESULT(yes)
-     AC_DEFINE(HAVE_ATOMIC_GCC,, [Defined if <bits/atomicity.h> is usable]) 
+     AC_DEFINE(HAVE_ATOMIC_GCC,, [Defined if gcc's atomic builtins are usable]) 
    ],
    [ AC_MSG_RESULT(no)
 
@@ -63,8 +62,6 @@ AC_DEFUN(AM_ENABLE_ATOMIC_GCC,
        AC_MSG_ERROR(${ATOMIC_GCC_ERROR})   
      fi
    ])
-
- ])
  
 fi
 
@@ -18,23 +18,21 @@ dnl WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
 dnl CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 dnl
-dnl Enables AM_ENABLE_ATOMIC_LINUX to test for a working 
-dnl <asm/atomic.h> header. Not all linux distributions
-dnl seem to include one that exposes atomic_inc() & 
-dnl atomic_dec_and_test()
+dnl Enables AM_ENABLE_ATOMIC_LINUX to test for the compiler's 
+dnl atomic builtins, used to build a spinning FastLock on linux.
+dnl The <asm/atomic.h> kernel header that was once used is not
+dnl exported to userspace by current distributions.
 dnl
 dnl --enable-atomic-linux=yes|no [default=no]
-dnl --with-atomic-linux-include=kernel header path [optional]
 dnl 
 dnl If support is available, then HAVE_ATOMIC_LINUX 
-dnl will be set and CXXFLAGS will be updated
+dnl will be set
 dnl
 ifdef(AM_ENABLE_ATOMIC_LINUX,,[
 
 ATOMIC_LINUX_ERROR=<<"EOF"
-This system does not contain an <asm/atomic.h> kernel header 
-that exposes atomic the neccessary atomic functions. Not all
-Linux distributions do.
+This compiler does not provide the __sync_fetch_and_add() and
+__sync_bool_compare_and_swap() builtins.
 EOF
 
 atomic_linux_explicit="no"
@@ -46,45 +44,26 @@ AC_DEFUN(AM_ENABLE_ATOMIC_LINUX,
  [atomic_linux_explicit="yes"], 
  [enable_atomic_linux="no"])
 
- AC_ARG_WITH(atomic-linux-include,
-	AC_HELP_STRING([--with-atmoic-linux-include],
-		       [path to kernel headers (optional)]),
- [atomic_prefix="$withval"
-  enable_atomic_linux="yes"
-  atomic_linux_explicit="yes"
- ], 
- [atomic_prefix=""])
-
  if test $enable_atomic_linux = "yes"; then
  
-   ac_save_CXXFLAGS="$CXXFLAGS"
-
-   if test x$atomic_prefix != x; then
-     CXXFLAGS="$CXXFLAGS -I$atomic_prefix"
-   fi
+   AC_MSG_CHECKING([for __sync_fetch_and_add(), __sync_bool_compare_and_swap() support])
 
- AC_CHECK_HEADER([asm/atomic.h],
- [ AC_MSG_CHECKING([for atomic_inc(), atomic_dec_and_test() support])
-
-   AC_TRY_LINK([#include <asm/atomic.h>],
+   AC_TRY_LINK([],
    [
-	atomic_t i = ATOMIC_INIT(0); 
-	atomic_inc(&i); 
-	atomic_dec_and_test(&i);
+	unsigned int i = 0;
+	__sync_fetch_and_add(&i, 1);
+	__sync_bool_compare_and_swap(&i, 1, 0);
 
    ],
    [ AC_MSG_RESULT(yes)
-     AC_DEFINE(HAVE_ATOMIC_LINUX,, [Defined if <asm/atomic.h> is usable]) 
+     AC_DEFINE(HAVE_ATOMIC_LINUX,, [Defined if the compiler's atomic builtins are usable on linux]) 
    ],
    [ AC_MSG_RESULT(no) 
-     CXXFLAGS="$ac_save_CXXFLAGS"
 
      if test $atomic_linux_explicit = "yes"; then
        AC_MSG_ERROR(${ATOMIC_LINUX_ERROR})
      fi
    ])
-
- ])
  
 fi
 
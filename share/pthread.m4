@@ -117,6 +117,10 @@ pthread_explicit="no"
   [ AC_DEFINE(HAVE_SCHED_RT,,[Defined if -lrt is needed for RT scheduling])
     PTHREAD_LIBS="$LIBS -lrt" ])
 
+  dnl Check for clock_gettime, which older systems keep in the rt library
+  AC_SEARCH_LIBS(clock_gettime, rt,
+  [ AC_DEFINE(HAVE_CLOCK_GETTIME,,[Defined if clock_gettime() is available]) ])
+
   AC_SUBST(PTHREAD_LIBS)
   AC_SUBST(PTHREAD_CXXFLAGS)
 
@@ -128,6 +132,38 @@ pthread_explicit="no"
       AC_DEFINE(HAVE_SCHED_YIELD,,[Defined if sched_yield() is available]) ],  
     [ AC_MSG_RESULT(no) ])
 
+  dnl Check for sched_setaffinity, a GNU extension
+  AC_MSG_CHECKING(for sched_setaffinity);
+  AC_TRY_LINK([#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>],
+    [ cpu_set_t set; CPU_ZERO(&set); CPU_SET(0, &set); sched_setaffinity(0, sizeof(set), &set); ], 
+    [ AC_MSG_RESULT(yes)
+      AC_DEFINE(HAVE_SCHED_SETAFFINITY,,[Defined if sched_setaffinity() is available]) ],  
+    [ AC_MSG_RESULT(no) ])
+
+  dnl Check for sched_getcpu, a GNU extension
+  AC_MSG_CHECKING(for sched_getcpu);
+  AC_TRY_LINK([#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>],
+    [ sched_getcpu(); ], 
+    [ AC_MSG_RESULT(yes)
+      AC_DEFINE(HAVE_SCHED_GETCPU,,[Defined if sched_getcpu() is available]) ],  
+    [ AC_MSG_RESULT(no) ])
+
+  dnl Check for the linux futex system call
+  AC_MSG_CHECKING(for futex);
+  AC_TRY_LINK([#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>],
+    [ int word = 0; syscall(SYS_futex, &word, FUTEX_WAKE, 1, 0, 0, 0); ], 
+    [ AC_MSG_RESULT(yes)
+      AC_DEFINE(HAVE_LINUX_FUTEX,,[Defined if the linux futex() system call is available]) ],  
+    [ AC_MSG_RESULT(no) ])
+
   dnl Check for pthread_yield
   AC_MSG_CHECKING(for pthread_yield);
   AC_TRY_LINK([#include <pthread.h>],
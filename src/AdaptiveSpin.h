@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTADAPTIVESPIN_H__
+#define __ZTADAPTIVESPIN_H__
+
+#include "zthread/Config.h"
+#include "AtomicOps.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(ZT_WIN32) || defined(ZT_WIN9X)
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace ZThread {
+
+  /**
+   * @class AdaptiveSpin
+   * @version 2.3.3
+   *
+   * Decides how long a thread finding a lock held should spin before it is
+   * put to sleep. Each lock keeps its own budget, learned from how long recent
+   * callers had to spin before the lock was released: short critical sections 
+   * raise it, spins that run out lower it. Nothing is spun on a single processor,
+   * where the thread holding the lock can't be running while another spins.
+   */
+  class AdaptiveSpin {
+
+    //! Bounds of the budget, in pause instructions
+    enum { FLOOR = 16, CEILING = 4096, INITIAL = 256 };
+
+    //! Pauses a caller may spend waiting for the lock to be released
+    volatile unsigned int _budget;
+
+    static unsigned int countProcessors() {
+
+#if defined(ZT_WIN32) || defined(ZT_WIN9X)
+
+      SYSTEM_INFO info;
+      ::GetSystemInfo(&info);
+
+      return (unsigned int)info.dwNumberOfProcessors;
+
+#elif defined(_SC_NPROCESSORS_ONLN)
+
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+      return n > 0 ? (unsigned int)n : 1;
+
+#else
+
+      return 1;
+
+#endif
+
+    }
+
+    // Updates race with each other, which only costs an update
+    inline void learn(unsigned int target) {
+
+      unsigned int budget = AtomicOps::load(_budget);
+      budget = budget + ((int)target - (int)budget) / 8;
+
+      AtomicOps::store(_budget, budget < FLOOR ? (unsigned int)FLOOR : 
+                                budget > CEILING ? (unsigned int)CEILING : budget);
+
+    }
+
+  public:
+
+    AdaptiveSpin() : _budget(INITIAL) { }
+
+    //! Number of processors available to the process
+    static unsigned int processors() {
+
+      static unsigned int n = countProcessors();
+      return n;
+
+    }
+
+    /**
+     * Spin until the given word holds the value the lock has when it is free,
+     * or until the budget runs out.
+     *
+     * @return bool true if the lock was seen free
+     */
+    template <typename T>
+    bool spin(const volatile T& word, T free) {
+
+#if !defined(ZTHREAD_DISABLE_ADAPTIVE_SPIN)
+
+      if(processors() < 2)
+        return false;
+
+      unsigned int budget = AtomicOps::load(_budget);
+
+      for(unsigned int n = 0; n < budget; ++n) {
+
+        if(AtomicOps::load(word) == free) {
+
+          // Allow for twice the wait just seen
+          learn(2 * n + FLOOR);
+          return true;
+
+        }
+
+        AtomicOps::pause();
+
+      }
+
+      learn(budget / 2);
+
+#endif
+
+      return false;
+
+    }
+
+  }; /* AdaptiveSpin */
+
+} // namespace ZThread
+
+#endif // __ZTADAPTIVESPIN_H__
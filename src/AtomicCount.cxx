@@ -52,6 +52,29 @@
 #endif
 */
 
+#include "AtomicOps.h"
+
+// Keep the count inline when the compiler provides atomic intrinsics
+#if !defined(ZT_VANILLA) && (defined(ZT_ATOMIC_BUILTINS) || defined(ZT_SYNC_BUILTINS))
+#  include "gcc/AtomicCount.cxx"
+#else
 #  include "vanilla/SimpleAtomicCount.cxx"
+#endif
+
+// Provide the lock used by AtomicOps when no atomic intrinsics are available
+#if !defined(ZT_ATOMIC_BUILTINS) && !defined(ZT_SYNC_BUILTINS)
+
+namespace ZThread {
+
+  FastLock& AtomicOps::lock() {
+
+    static FastLock instance;
+    return instance;
+
+  }
+
+}
+
+#endif
 
 #endif // __ZTATOMICCOUNTSELECT_H__
@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTATOMICOPS_H__
+#define __ZTATOMICOPS_H__
+
+#include "zthread/Config.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// Select the compiler intrinsics used to implement the atomic operations,
+// falling back to a single FastLock when nothing better is available
+
+#if defined(__clang__) || \
+    (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#  define ZT_ATOMIC_BUILTINS 1
+#elif defined(__GNUC__) && (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)
+#  define ZT_SYNC_BUILTINS 1
+#else
+#  include "FastLock.h"
+#  include "zthread/Guard.h"
+#endif
+
+namespace ZThread {
+
+  /**
+   * @class AtomicOps
+   * @version 2.3.3
+   *
+   * A small set of atomic operations on word sized integers and pointers,
+   * used by the parts of the library that avoid taking a FastLock on their
+   * fast paths. Loads and read-modify-write operations are sequentially 
+   * consistent, stores have release semantics.
+   */
+  class AtomicOps {
+
+#if !defined(ZT_ATOMIC_BUILTINS) && !defined(ZT_SYNC_BUILTINS)
+
+    //! Serialize every operation when no intrinsics are available
+    static FastLock& lock();
+
+#endif
+
+  public:
+
+#if defined(ZT_ATOMIC_BUILTINS)
+
+    template <typename T>
+    static inline T load(const volatile T& v) {
+      return __atomic_load_n(&v, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T>
+    static inline void store(volatile T& v, T value) {
+      __atomic_store_n(&v, value, __ATOMIC_RELEASE);
+    }
+
+    template <typename T>
+    static inline T exchange(volatile T& v, T value) {
+      return __atomic_exchange_n(&v, value, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T>
+    static inline bool cas(volatile T& v, T expected, T value) {
+      return __atomic_compare_exchange_n(&v, &expected, value, false, 
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T, typename U>
+    static inline T fetchAndAdd(volatile T& v, U delta) {
+      return __atomic_fetch_add(&v, delta, __ATOMIC_SEQ_CST);
+    }
+
+    static inline void fence() {
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+#elif defined(ZT_SYNC_BUILTINS)
+
+    template <typename T>
+    static inline T load(const volatile T& v) {
+      T value = v;
+      __sync_synchronize();
+      return value;
+    }
+
+    template <typename T>
+    static inline void store(volatile T& v, T value) {
+      __sync_synchronize();
+      v = value;
+    }
+
+    template <typename T>
+    static inline T exchange(volatile T& v, T value) {
+
+      T old;
+      do { old = v; } while(!__sync_bool_compare_and_swap(&v, old, value));
+
+      return old;
+
+    }
+
+    template <typename T>
+    static inline bool cas(volatile T& v, T expected, T value) {
+      return __sync_bool_compare_and_swap(&v, expected, value);
+    }
+
+    template <typename T, typename U>
+    static inline T fetchAndAdd(volatile T& v, U delta) {
+      return __sync_fetch_and_add(&v, delta);
+    }
+
+    static inline void fence() {
+      __sync_synchronize();
+    }
+
+#else
+
+    template <typename T>
+    static inline T load(const volatile T& v) {
+      Guard<FastLock> g(lock());
+      return v;
+    }
+
+    template <typename T>
+    static inline void store(volatile T& v, T value) {
+      Guard<FastLock> g(lock());
+      v = value;
+    }
+
+    template <typename T>
+    static inline T exchange(volatile T& v, T value) {
+
+      Guard<FastLock> g(lock());
+
+      T old = v;
+      v = value;
+
+      return old;
+
+    }
+
+    template <typename T>
+    static inline bool cas(volatile T& v, T expected, T value) {
+
+      Guard<FastLock> g(lock());
+
+      if(v != expected)
+        return false;
+
+      v = value;
+      return true;
+
+    }
+
+    template <typename T, typename U>
+    static inline T fetchAndAdd(volatile T& v, U delta) {
+
+      Guard<FastLock> g(lock());
+
+      T old = v;
+      v = old + delta;
+
+      return old;
+
+    }
+
+    static inline void fence() {
+      Guard<FastLock> g(lock());
+    }
+
+#endif
+
+    //! Atomically increment and return the new value
+    template <typename T>
+    static inline T increment(volatile T& v) {
+      return fetchAndAdd(v, 1) + 1;
+    }
+
+    //! Atomically decrement and return the new value
+    template <typename T>
+    static inline T decrement(volatile T& v) {
+      return fetchAndAdd(v, -1) - 1;
+    }
+
+    //! Hint to the processor that the caller is busy-waiting
+    static inline void pause() {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+      __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__GNUC__) && (defined(__aarch64__) || defined(__arm__))
+      __asm__ __volatile__("yield" ::: "memory");
+#elif defined(__GNUC__)
+      __asm__ __volatile__("" ::: "memory");
+#endif
+    }
+
+  }; /* AtomicOps */
+
+} // namespace ZThread
+
+#endif // __ZTATOMICOPS_H__
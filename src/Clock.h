@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTCLOCK_H__
+#define __ZTCLOCK_H__
+
+#include "zthread/Config.h"
+#include "zthread/Time.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined(ZT_WIN32) || defined(ZT_WIN9X)
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#  include <time.h>
+#endif
+
+namespace ZThread {
+
+  /**
+   * @class Clock
+   * @version 2.3.3
+   *
+   * Fine grained clocks used to time tasks. Time, which counts milliseconds, 
+   * is too coarse for that.
+   */
+  class Clock {
+  public:
+
+    //! Microseconds from some fixed point, not affected by changes to the date where possible
+    static unsigned long long microseconds() {
+
+#if defined(ZT_WIN32) || defined(ZT_WIN9X)
+
+      LARGE_INTEGER now, frequency;
+
+      ::QueryPerformanceCounter(&now);
+      ::QueryPerformanceFrequency(&frequency);
+
+      return (unsigned long long)(now.QuadPart / (frequency.QuadPart / 1000000.0));
+
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+
+      return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+#else
+
+      struct timeval now;
+      gettimeofday(&now, 0);
+
+      return (unsigned long long)now.tv_sec * 1000000 + now.tv_usec;
+
+#endif
+
+    }
+
+    //! Processor time (microseconds) used by the calling thread, 0 where it can't be measured
+    static unsigned long long threadTime() {
+
+#if defined(ZT_WIN32)
+
+      FILETIME creation, exit, kernel, user;
+
+      if(!::GetThreadTimes(::GetCurrentThread(), &creation, &exit, &kernel, &user))
+        return 0;
+
+      // 100 nanosecond units
+      unsigned long long k = ((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+      unsigned long long u = ((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime;
+
+      return (k + u) / 10;
+
+#elif defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_THREAD_CPUTIME_ID)
+
+      struct timespec now;
+      if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0)
+        return 0;
+
+      return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+#else
+
+      return 0;
+
+#endif
+
+    }
+
+  }; /* Clock */
+
+  //! Milliseconds since startup, the tick executors use to age and time out tasks
+  inline unsigned long currentTick() {
+
+    Time now;
+    return now.seconds() * 1000 + now.milliseconds();
+
+  }
+
+} // namespace ZThread
+
+#endif // __ZTCLOCK_H__
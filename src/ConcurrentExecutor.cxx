@@ -34,6 +34,10 @@ namespace ZThread {
   void ConcurrentExecutor::execute(const Task& task) {
     _executor.execute(task);
   }
+
+  void ConcurrentExecutor::executeBatch(const Task* tasks, size_t n) {
+    _executor.executeBatch(tasks, n);
+  }
     
   void ConcurrentExecutor::cancel() {
     _executor.cancel();
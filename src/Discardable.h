@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTDISCARDABLE_H__
+#define __ZTDISCARDABLE_H__
+
+namespace ZThread {
+
+  /**
+   * @class Discardable
+   * @version 2.3.3
+   *
+   * Implemented by Runnables the library hands to an Executor that need to 
+   * know when the Executor drops them without running them, so that whatever
+   * waits for them is not left waiting forever.
+   */
+  class Discardable {
+  public:
+
+    //! Discardables should never throw in their destructors
+    virtual ~Discardable() {}
+
+    //! Called, instead of run(), when the task is dropped
+    virtual void discard() = 0;
+
+  };
+
+} // namespace ZThread
+
+#endif // __ZTDISCARDABLE_H__
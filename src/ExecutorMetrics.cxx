@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/ExecutorMetrics.h"
+
+namespace ZThread {
+
+  LatencyHistogram::LatencyHistogram() : total(0) {
+
+    for(size_t i = 0; i < BUCKETS; ++i)
+      counts[i] = 0;
+
+  }
+
+  size_t LatencyHistogram::samples() const {
+
+    size_t n = 0;
+
+    for(size_t i = 0; i < BUCKETS; ++i)
+      n += counts[i];
+
+    return n;
+
+  }
+
+  unsigned long long LatencyHistogram::mean() const {
+
+    size_t n = samples();
+    return n == 0 ? 0 : total / n;
+
+  }
+
+  unsigned long long LatencyHistogram::percentile(double p) const {
+
+    size_t n = samples();
+    if(n == 0)
+      return 0;
+
+    // Rank of the sample the percentile falls on, at least the first
+    double rank = p / 100.0 * n;
+    size_t seen = 0;
+
+    for(size_t i = 0; i < BUCKETS; ++i) {
+
+      seen += counts[i];
+
+      if(seen > 0 && seen >= rank)
+        return 1ULL << (i + 1);
+
+    }
+
+    return 1ULL << BUCKETS;
+
+  }
+
+  void LatencyHistogram::add(unsigned long long duration) {
+
+    total += duration;
+
+    size_t i = 0;
+
+    while(duration > 1 && i < BUCKETS - 1) {
+
+      duration >>= 1;
+      ++i;
+
+    }
+
+    ++counts[i];
+
+  }
+
+  LatencyHistogram& LatencyHistogram::operator+=(const LatencyHistogram& h) {
+
+    for(size_t i = 0; i < BUCKETS; ++i)
+      counts[i] += h.counts[i];
+
+    total += h.total;
+    return *this;
+
+  }
+
+  WorkerMetrics::WorkerMetrics() : completed(0), busy(0), idle(0), cpu(0) { }
+
+  double WorkerMetrics::utilization() const {
+
+    unsigned long long lifetime = busy + idle;
+    return lifetime == 0 ? 0.0 : (double)busy / lifetime;
+
+  }
+
+  WorkerMetrics& WorkerMetrics::operator+=(const WorkerMetrics& w) {
+
+    completed += w.completed;
+    busy      += w.busy;
+    idle      += w.idle;
+    cpu       += w.cpu;
+
+    return *this;
+
+  }
+
+  ExecutorMetrics::ExecutorMetrics() : submitted(0), completed(0), dropped(0), expired(0), missed(0), 
+      rejected(0), discarded(0), depth(0) { }
+
+} // namespace ZThread
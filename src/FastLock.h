@@ -29,19 +29,31 @@
 #include "config.h"
 #endif
 
+// Locks built on a linux futex need the compiler's atomic intrinsics
+
+#if defined(ZT_POSIX) && defined(HAVE_LINUX_FUTEX) && !defined(ZT_VANILLA) && \
+    (defined(__clang__) || \
+     (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))))
+#  define ZT_FUTEX 1
+#endif
+
 // Select the correct FastLock implementation based on
 // what the compilation environment has defined
 
 #if defined(ZT_POSIX)
 
-#  if defined(HAVE_ATOMIC_LINUX)
+#  if defined(HAVE_ATOMIC_LINUX) || defined(HAVE_ATOMIC_GCC)
 
 #    if defined(ZTHREAD_USE_SPIN_LOCKS)
-#      include "linux/AtomicFastLock.h"
+#      include "gcc/AtomicFastLock.h"
 #    endif
 
 #  endif
 
+#  if defined(ZT_FUTEX)
+#    include "linux/FutexFastLock.h"
+#  endif
+
 #  include "posix/FastLock.h"
 
 // Use spin locks
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/FutureImpl.h"
+#include "zthread/Condition.h"
+#include "zthread/Exceptions.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "AtomicOps.h"
+
+#include <deque>
+#include <exception>
+
+namespace ZThread {
+
+  namespace {
+
+    /**
+     * @class FutureWaiters
+     *
+     * Everything needed to block for a result or defer a continuation. This
+     * is only allocated by the first thread that needs it.
+     */
+    class FutureWaiters {
+    public:
+
+      typedef std::deque<Task> TaskList;
+
+      FastMutex lock;
+      Condition done;
+      TaskList continuations;
+
+      FutureWaiters() : done(lock) { }
+
+    };
+
+    //! Test for a result that is DONE, FAILED or CANCELED
+    inline bool isTerminal(long state) {
+      return state > FutureImpl::SETTING;
+    }
+
+    //! Run a list of continuations, they should not throw
+    void runAll(FutureWaiters::TaskList& list) {
+
+      for(FutureWaiters::TaskList::iterator i = list.begin(); i != list.end(); ++i) {
+
+        try {
+          (*i)->run();
+        } catch(...) { }
+
+      }
+
+    }
+
+  } // namespace
+
+  FutureImpl::FutureImpl() 
+    : _state(PENDING), _count(1), _waiters(0) { }
+
+  FutureImpl::~FutureImpl() {
+    delete reinterpret_cast<FutureWaiters*>(_waiters);
+  }
+
+  void FutureImpl::addReference() {
+    AtomicOps::increment(_count);
+  }
+
+  void FutureImpl::delReference() {
+
+    if(AtomicOps::decrement(_count) == 0)
+      delete this;
+
+  }
+
+  bool FutureImpl::isDone() const {
+    return isTerminal(AtomicOps::load(_state));
+  }
+
+  bool FutureImpl::isCanceled() const {
+    return AtomicOps::load(_state) == CANCELED;
+  }
+
+  bool FutureImpl::isSet() const {
+    return AtomicOps::load(_state) == DONE;
+  }
+
+  bool FutureImpl::claim() {
+    return AtomicOps::cas(_state, (long)PENDING, (long)SETTING);
+  }
+
+  bool FutureImpl::cancel() {
+
+    if(!claim())
+      return false;
+
+    complete(CANCELED);
+    return true;
+
+  }
+
+  bool FutureImpl::fail(const char* error) {
+
+    if(!claim())
+      return false;
+
+    complete(FAILED, error);
+    return true;
+
+  }
+
+  bool FutureImpl::failCurrent() {
+
+    try {
+      throw;
+    } catch(Synchronization_Exception& e) {
+      return fail(e.what());
+    } catch(std::exception& e) {
+      return fail(e.what());
+    } catch(...) {
+      return fail("Unknown exception");
+    }
+
+  }
+
+  void FutureImpl::complete(STATE state, const char* error) {
+
+    if(error)
+      _error = error;
+
+    // Publish the result; nothing else writes the state once it is terminal
+    AtomicOps::exchange(_state, (long)state);
+
+    // Only take the lock if some thread has blocked, or deferred a continuation
+    FutureWaiters* waiters = 
+      reinterpret_cast<FutureWaiters*>(AtomicOps::load(_waiters));
+
+    if(!waiters)
+      return;
+
+    FutureWaiters::TaskList list;
+
+    {
+
+      Guard<FastMutex> g(waiters->lock);
+
+      waiters->done.broadcast();
+      list.swap(waiters->continuations);
+
+    }
+
+    runAll(list);
+
+  }
+
+  void FutureImpl::check() const {
+
+    switch(AtomicOps::load(_state)) {
+
+      case FAILED:
+        throw Future_Exception(_error.c_str());
+
+      case CANCELED:
+        throw Cancellation_Exception();
+
+      default:
+        break;
+
+    }
+
+  }
+
+  namespace {
+
+    //! Get the FutureWaiters for a result, creating them if needed
+    FutureWaiters* waitersFor(void* volatile& slot) {
+
+      FutureWaiters* waiters = reinterpret_cast<FutureWaiters*>(AtomicOps::load(slot));
+      if(waiters)
+        return waiters;
+
+      FutureWaiters* created = new FutureWaiters;
+      if(AtomicOps::cas(slot, (void*)0, (void*)created))
+        return created;
+
+      delete created;
+      return reinterpret_cast<FutureWaiters*>(AtomicOps::load(slot));
+
+    }
+
+  } // namespace
+
+  void FutureImpl::wait() {
+
+    if(isDone())
+      return;
+
+    FutureWaiters* waiters = waitersFor(_waiters);
+    Guard<FastMutex> g(waiters->lock);
+
+    // The state is re-tested under the lock, which complete() takes after 
+    // publishing the result, so a wakeup can not be missed
+    while(!isDone())
+      waiters->done.wait();
+
+  }
+
+  bool FutureImpl::wait(unsigned long timeout) {
+
+    if(isDone())
+      return true;
+
+    FutureWaiters* waiters = waitersFor(_waiters);
+    Guard<FastMutex> g(waiters->lock);
+
+    while(!isDone())
+      if(!waiters->done.wait(timeout))
+        return isDone();
+
+    return true;
+
+  }
+
+  void FutureImpl::whenDone(const Task& task) {
+
+    if(!isDone()) {
+
+      FutureWaiters* waiters = waitersFor(_waiters);
+      Guard<FastMutex> g(waiters->lock);
+
+      if(!isDone()) {
+
+        waiters->continuations.push_back(task);
+        return;
+
+      }
+
+    }
+
+    // Run a copy, the caller's Task is const
+    Task t(task);
+
+    try {
+      t->run();
+    } catch(...) { }
+
+  }
+
+} // namespace ZThread
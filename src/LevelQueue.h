@@ -0,0 +1,633 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTLEVELQUEUE_H__
+#define __ZTLEVELQUEUE_H__
+
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/Priority.h"
+#include "zthread/Queue.h"
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace ZThread {
+
+  /**
+   * @class LevelQueue
+   * @version 2.3.3
+   *
+   * A LevelQueue is a Queue implementation that keeps a separate FIFO queue for
+   * each Priority. Values added without a Priority are Medium priority.
+   *
+   * - In <em>Strict</em> mode next() always returns a value of the highest 
+   *   priority present. 
+   *
+   * - In <em>Weighted</em> mode the levels share next() in proportion to their 
+   *   weights, so lower levels make progress under a steady stream of higher
+   *   priority values.
+   *
+   * - With aging enabled, a value that has stayed queued while a given number
+   *   of values were taken is returned next, regardless of its priority, so that
+   *   no level can be starved.
+   *
+   * Values added with a deadline are kept in a heap and returned earliest 
+   * deadline first, ahead of the values of every level, but no more than a 
+   * given number in a row while a level has values waiting; after that the 
+   * levels are served once, as the policy chooses. Aging still applies to the
+   * levels.
+   *
+   * Threads blocked by next() are only signaled when some thread is known to
+   * be blocked.
+   *
+   * @see Queue
+   */
+  template <class T>
+    class LevelQueue : public Queue<T> {
+
+    public:
+
+      //! Orders in which levels are served
+      typedef enum {
+
+        //! Highest priority first
+        Strict,
+
+        //! Levels share in proportion to their weights
+        Weighted
+
+      } Policy;
+
+    private:
+
+      static const size_t LEVELS = High + 1;
+
+      //! Value and the number of values taken when it was added
+      typedef std::pair<T, size_t> Entry;
+      typedef std::deque<Entry> Level;
+
+      //! Value with a deadline, the order it was added in and the values taken by then
+      struct Timed {
+
+        T item;
+        unsigned long deadline;
+        size_t sequence;
+        size_t taken;
+
+        Timed(const T& i, unsigned long d, size_t s, size_t t) 
+          : item(i), deadline(d), sequence(s), taken(t) { }
+
+      };
+
+      //! Heap order, earliest deadline on top; deadlines may wrap around
+      struct Later {
+
+        bool operator()(const Timed& a, const Timed& b) const {
+
+          long d = (long)(a.deadline - b.deadline);
+          return d > 0 || (d == 0 && a.sequence > b.sequence);
+
+        }
+
+      };
+
+      //! Serialize access
+      FastMutex _lock;
+
+      //! Signaled on not empty
+      Condition _notEmpty;
+
+      //! Storage for each priority
+      Level _levels[LEVELS];
+
+      //! Values with a deadline, a heap ordered by Later
+      std::vector<Timed> _deadlines;
+
+      //! Values added with a deadline so far, keeps equal deadlines in order
+      size_t _sequence;
+
+      //! Number of values stored, readable without the lock
+      volatile size_t _count;
+
+      //! Number of values taken, used to age queued values
+      size_t _taken;
+
+      //! Cancellation flag
+      volatile bool _canceled;
+
+      //! Number of threads blocked in next() that have not been signaled
+      size_t _idle;
+
+      //! Number of threads blocked in next() that have been signaled
+      size_t _signaled;
+
+      Policy _policy;
+
+      //! Values taken before a queued value is returned first, 0 disables aging
+      size_t _aging;
+
+      //! Deadline values returned in a row while a level waits, 0 for no limit
+      size_t _burst;
+
+      //! Deadline values returned in a row while a level waited
+      size_t _run;
+
+      //! Share of each level in Weighted mode
+      size_t _weights[LEVELS];
+
+      //! Values each level may still return in the current Weighted round
+      size_t _credits[LEVELS];
+
+      //! Block until signaled, counting the calling thread as idle 
+      bool waitNotEmpty(bool timed, unsigned long timeout) {
+
+        bool signaled = true;
+        ++_idle;
+
+        try {
+
+          if(timed)
+            signaled = _notEmpty.wait(timeout);
+          else
+            _notEmpty.wait();
+
+        } catch(...) {
+
+          leaveIdle();
+          throw;
+
+        }
+
+        leaveIdle();
+        return signaled;
+
+      }
+
+      void leaveIdle() {
+
+        if(_signaled > 0)
+          --_signaled;
+        else
+          --_idle;
+
+      }
+
+      //! Wake up to n idle threads
+      void wakeIdle(size_t n) {
+
+        for(; n > 0 && _idle > 0; --n) {
+
+          --_idle;
+          ++_signaled;
+
+          _notEmpty.signal();
+
+        }
+
+      }
+
+      //! Level the next value comes from, LEVELS for the deadline heap
+      size_t choose() {
+
+        // Overdue values first, oldest first
+        if(_aging > 0) {
+
+          size_t level = LEVELS;
+
+          for(size_t i = 0; i < LEVELS; ++i)
+            if(!_levels[i].empty() && _taken - _levels[i].front().second >= _aging &&
+               (level == LEVELS || _levels[i].front().second < _levels[level].front().second))
+              level = i;
+
+          if(level != LEVELS) {
+
+            _run = 0;
+            return level;
+
+          }
+
+        }
+
+        // Deadline values first, but only so many in a row while a level waits
+        if(!_deadlines.empty()) {
+
+          bool waiting = _count > _deadlines.size();
+
+          if(!waiting || _burst == 0 || _run < _burst) {
+
+            if(waiting)
+              ++_run;
+
+            return LEVELS;
+
+          }
+
+        }
+
+        _run = 0;
+
+        if(_policy == Weighted) {
+
+          for(int pass = 0; pass < 2; ++pass) {
+
+            for(size_t i = LEVELS; i-- > 0; )
+              if(!_levels[i].empty() && _credits[i] > 0) {
+
+                --_credits[i];
+                return i;
+
+              }
+
+            // Every level with values has used its share, start a new round
+            for(size_t i = 0; i < LEVELS; ++i)
+              _credits[i] = _weights[i];
+
+          }
+
+        }
+
+        for(size_t i = LEVELS; i-- > 0; )
+          if(!_levels[i].empty())
+            return i;
+
+        return Medium;
+
+      }
+
+      T take() {
+
+        size_t chosen = choose();
+        T item;
+
+        if(chosen == LEVELS) {
+
+          std::pop_heap(_deadlines.begin(), _deadlines.end(), Later());
+
+          item = _deadlines.back().item;
+          _deadlines.pop_back();
+
+        } else {
+
+          Level& level = _levels[chosen];
+
+          item = level.front().first;
+          level.pop_front();
+
+        }
+
+        ++_taken;
+        --_count;
+
+        return item;
+
+      }
+
+    public:
+
+      //! Create a new LevelQueue
+      LevelQueue() 
+        : _notEmpty(_lock), _sequence(0), _count(0), _taken(0), _canceled(false), 
+          _idle(0), _signaled(0), _policy(Strict), _aging(0), _burst(8), _run(0) {
+
+        _weights[Low]    = 1;
+        _weights[Medium] = 2;
+        _weights[High]   = 4;
+
+        for(size_t i = 0; i < LEVELS; ++i)
+          _credits[i] = _weights[i];
+
+      }
+
+      //! Destroy a LevelQueue, delete remaining items
+      virtual ~LevelQueue() { }
+
+      /**
+       * Set how levels are served.
+       *
+       * @param policy Strict or Weighted
+       * @param aging number of values taken after which a value still queued
+       *        is returned first; 0 disables aging
+       * @param burst most deadline values returned in a row while a level has
+       *        values; 0 for no limit
+       */
+      void policy(Policy policy, size_t aging, size_t burst = 8) {
+
+        Guard<FastMutex> g(_lock);
+
+        _policy = policy;
+        _aging  = aging;
+        _burst  = burst;
+        _run    = 0;
+
+      }
+
+      /**
+       * Set the share of each level in Weighted mode. A weight of 0 is 
+       * treated as 1.
+       */
+      void weights(size_t low, size_t medium, size_t high) {
+
+        Guard<FastMutex> g(_lock);
+
+        _weights[Low]    = low    ? low    : 1;
+        _weights[Medium] = medium ? medium : 1;
+        _weights[High]   = high   ? high   : 1;
+
+        for(size_t i = 0; i < LEVELS; ++i)
+          _credits[i] = _weights[i];
+
+      }
+
+      /**
+       * Add a Medium priority value to this Queue. 
+       *
+       * @see Queue::add(const T& item)
+       */
+      virtual void add(const T& item) {
+        add(item, Medium);
+      }
+
+      /**
+       * Add a value to this Queue. 
+       *
+       * @param item value to be added to the Queue
+       * @param priority level to add the value to
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       */
+      void add(const T& item, Priority priority) {
+
+        Guard<FastMutex> g(_lock);
+    
+        if(_canceled)
+          throw Cancellation_Exception();
+
+        _levels[priority].push_back(Entry(item, _taken));
+        ++_count;
+
+        wakeIdle(1);
+
+      }
+
+      /**
+       * Add a value with a deadline to this Queue. Values with a deadline are 
+       * returned earliest deadline first, before the values of any level, up to
+       * the burst set by policy().
+       *
+       * @param item value to be added to the Queue
+       * @param deadline deadline, in milliseconds on any clock that wraps 
+       *        around like an unsigned long
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       */
+      void addByDeadline(const T& item, unsigned long deadline) {
+
+        Guard<FastMutex> g(_lock);
+    
+        if(_canceled)
+          throw Cancellation_Exception();
+
+        _deadlines.push_back(Timed(item, deadline, _sequence++, _taken));
+        std::push_heap(_deadlines.begin(), _deadlines.end(), Later());
+
+        ++_count;
+
+        wakeIdle(1);
+
+      }
+
+      /**
+       * Add a Medium priority value to this Queue; adding to a LevelQueue 
+       * does not wait.
+       *
+       * @see Queue::add(const T& item, unsigned long timeout)
+       */
+      virtual bool add(const T& item, unsigned long) {
+
+        add(item, Medium);
+        return true;
+
+      }
+
+      /**
+       * Add a range of values to this Queue, holding the lock once and waking 
+       * at most one blocked thread for each value added.
+       *
+       * @param begin first value to be added to the Queue
+       * @param end position after the last value to be added
+       * @param priority level to add the values to
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       */
+      template <class InputIterator>
+      void addAll(InputIterator begin, InputIterator end, Priority priority = Medium) {
+
+        Guard<FastMutex> g(_lock);
+    
+        if(_canceled)
+          throw Cancellation_Exception();
+
+        size_t n = 0;
+        for(; begin != end; ++begin, ++n) 
+          _levels[priority].push_back(Entry(*begin, _taken));
+
+        _count += n;
+
+        wakeIdle(n);
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue.
+       *
+       * @see Queue::next()
+       */
+      virtual T next() {
+      
+        Guard<FastMutex> g(_lock);
+      
+        while(_count == 0 && !_canceled) 
+          waitNotEmpty(false, 0);
+    
+        if(_count == 0) // Queue canceled
+          throw Cancellation_Exception();  
+
+        return take();
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue.
+       *
+       * @see Queue::next(unsigned long timeout)
+       */
+      virtual T next(unsigned long timeout) {
+  
+        Guard<FastMutex> g(_lock, timeout);
+      
+        while(_count == 0 && !_canceled) {
+          if(!waitNotEmpty(true, timeout))
+            throw Timeout_Exception();
+        }
+
+        if(_count == 0) // Queue canceled
+          throw Cancellation_Exception();  
+
+        return take();
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue, if one is available, 
+       * without blocking.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryNext(T& item) {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_count == 0)
+          return false;
+
+        item = take();
+        return true;
+
+      }
+
+      /**
+       * Retrieve and remove the value that has been queued longest, whatever
+       * its priority or deadline, if one is available, without blocking. Values
+       * added while the same number of values had been taken count as equally
+       * old.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryOldest(T& item) {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_count == 0)
+          return false;
+
+        // The front of each level is the oldest value of that level
+        size_t level = LEVELS;
+
+        for(size_t i = 0; i < LEVELS; ++i)
+          if(!_levels[i].empty() && 
+             (level == LEVELS || _levels[i].front().second < _levels[level].front().second))
+            level = i;
+
+        // The heap is not kept in the order values were added
+        typename std::vector<Timed>::iterator timed = _deadlines.end();
+
+        for(typename std::vector<Timed>::iterator i = _deadlines.begin(); i != _deadlines.end(); ++i)
+          if(timed == _deadlines.end() || i->sequence < timed->sequence)
+            timed = i;
+
+        if(timed != _deadlines.end() && 
+           (level == LEVELS || timed->taken < _levels[level].front().second)) {
+
+          item = timed->item;
+
+          *timed = _deadlines.back();
+          _deadlines.pop_back();
+
+          std::make_heap(_deadlines.begin(), _deadlines.end(), Later());
+
+        } else {
+
+          item = _levels[level].front().first;
+          _levels[level].pop_front();
+
+        }
+
+        --_count;
+        return true;
+
+      }
+
+      /**
+       * @see Queue::cancel()
+       */
+      virtual void cancel() {
+
+        Guard<FastMutex> g(_lock);
+
+        _canceled = true;
+        _notEmpty.broadcast(); 
+
+      }
+
+      /**
+       * @see Queue::isCanceled()
+       */
+      virtual bool isCanceled() {
+  
+        if(_canceled)
+          return true;
+    
+        Guard<FastMutex> g(_lock);
+        return _canceled;
+
+      }
+
+      /**
+       * Test, without blocking, whether a value appears to be available.
+       *
+       * @see MonitoredQueue::available()
+       */
+      bool available() const {
+        return _count > 0;
+      }
+
+      /**
+       * @see Queue::size()
+       */
+      virtual size_t size() {
+
+        Guard<FastMutex> g(_lock);
+        return _count;
+
+      }
+
+      /**
+       * @see Queue::size(unsigned long timeout)
+       */
+      virtual size_t size(unsigned long timeout) {
+
+        Guard<FastMutex> g(_lock, timeout);
+        return _count;
+
+      }
+
+    }; /* LevelQueue */
+
+} // namespace ZThread
+
+#endif // __ZTLEVELQUEUE_H__
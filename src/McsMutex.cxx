@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/McsMutex.h"
+#include "AtomicOps.h"
+#include "Clock.h"
+#include "ThreadOps.h"
+
+#include <assert.h>
+
+namespace ZThread {
+
+  namespace {
+
+    //! States of a Node
+    enum { WAITING = 0, GRANTED = 1, ABANDONED = 2 };
+
+    //! Pauses a waiter spends before it starts yielding its processor
+    const unsigned int PATIENCE = 1024;
+
+    inline void backoff(unsigned int n) {
+
+      if(n < PATIENCE)
+        AtomicOps::pause();
+      else
+        ThreadOps::yield();
+
+    }
+
+  }
+
+  McsMutex::McsMutex() : _tail(0), _holder(0) { }
+
+  McsMutex::~McsMutex() {
+    assert(_tail == 0);
+  }
+
+  void McsMutex::acquire() {
+
+    Node* node = new Node;
+    node->_owned = true;
+
+    acquire(*node);
+
+  }
+
+  void McsMutex::acquire(Node& node) {
+
+    node._next  = 0;
+    node._state = WAITING;
+
+    Node* pred = AtomicOps::exchange(_tail, &node);
+
+    if(pred != 0) {
+
+      AtomicOps::store(pred->_next, &node);
+
+      for(unsigned int n = 0; AtomicOps::load(node._state) != GRANTED; ++n)
+        backoff(n);
+
+    }
+
+    _holder = &node;
+
+  }
+
+  bool McsMutex::tryAcquire(unsigned long timeout) {
+
+    Node* node = new Node;
+    node->_owned = true;
+
+    if(grab(*node))
+      return true;
+
+    if(timeout == 0) {
+
+      delete node;
+      return false;
+
+    }
+
+    return wait(node, timeout);
+
+  }
+
+  bool McsMutex::tryAcquire(Node& node, unsigned long timeout) {
+
+    if(grab(node))
+      return true;
+
+    if(timeout == 0)
+      return false;
+
+    // A node given up on stays in the queue after the caller returns,
+    // so the caller's own node can't be the one that waits
+    Node* waiter = new Node;
+    waiter->_owned = true;
+
+    return wait(waiter, timeout);
+
+  }
+
+  void McsMutex::release() {
+
+    Node* node = _holder;
+
+    for(;;) {
+
+      Node* next = AtomicOps::load(node->_next);
+
+      if(next == 0) {
+
+        if(AtomicOps::cas(_tail, node, (Node*)0)) {
+
+          retire(node);
+          return;
+
+        }
+
+        // A successor has joined the queue but not yet linked itself in
+        for(unsigned int n = 0; (next = AtomicOps::load(node->_next)) == 0; ++n)
+          backoff(n);
+
+      }
+
+      retire(node);
+
+      if(AtomicOps::cas(next->_state, (int)WAITING, (int)GRANTED))
+        return;
+
+      // The successor gave up; hand the lock on from its node instead
+      node = next;
+
+    }
+
+  }
+
+  bool McsMutex::grab(Node& node) {
+
+    node._next  = 0;
+    node._state = WAITING;
+
+    if(!AtomicOps::cas(_tail, (Node*)0, &node))
+      return false;
+
+    _holder = &node;
+    return true;
+
+  }
+
+  bool McsMutex::wait(Node* node, unsigned long timeout) {
+
+    node->_next  = 0;
+    node->_state = WAITING;
+
+    Node* pred = AtomicOps::exchange(_tail, node);
+
+    if(pred != 0) {
+
+      AtomicOps::store(pred->_next, node);
+
+      unsigned long long deadline = Clock::microseconds() + (unsigned long long)timeout * 1000;
+
+      for(unsigned int n = 0; AtomicOps::load(node->_state) != GRANTED; ++n) {
+
+        // Abandon the node, unless the lock was handed to it in the meantime
+        if(n >= PATIENCE && Clock::microseconds() >= deadline &&
+           AtomicOps::cas(node->_state, (int)WAITING, (int)ABANDONED))
+          return false;
+
+        backoff(n);
+
+      }
+
+    }
+
+    _holder = node;
+    return true;
+
+  }
+
+  void McsMutex::retire(Node* node) {
+
+    if(node->_owned)
+      delete node;
+
+  }
+
+} // namespace ZThread
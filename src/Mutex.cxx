@@ -25,8 +25,16 @@
 
 namespace ZThread {
 
+#if defined(ZTHREAD_MUTEX_BARGING)
+
+  class FifoMutexImpl : public MutexImpl<fifo_list, NullBehavior, Barging> { };
+
+#else
+
   class FifoMutexImpl : public MutexImpl<fifo_list, NullBehavior> { };
 
+#endif
+
 
   Mutex::Mutex() {
 
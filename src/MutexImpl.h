@@ -23,6 +23,8 @@
 #include "zthread/Exceptions.h"
 #include "zthread/Guard.h"
 
+#include "AdaptiveSpin.h"
+#include "Clock.h"
 #include "Debug.h"
 #include "FastLock.h"
 #include "Scheduling.h"
@@ -52,18 +54,89 @@ protected:
 
 };
 
+/**
+ * @version 2.3.3
+ * @class DirectHandoff
+ *
+ * A released MutexImpl is handed to a waiting thread; no other thread may
+ * acquire it while threads are waiting. This is fair, but the mutex stays 
+ * unowned for as long as the chosen waiter takes to wake up.
+ */
+class DirectHandoff {
+protected:
+
+  inline bool mayBarge() const { return false; }
+
+  inline unsigned long long arrived() { return 0; }
+
+  inline void overtaken(unsigned long long, bool&) { }
+
+  inline void departed(bool) { }
+
+};
+
+/**
+ * @version 2.3.3
+ * @class Barging
+ *
+ * A released MutexImpl is free for any running thread to take, even while
+ * threads are waiting. The waiter that is woken competes for the mutex again
+ * and goes back to waiting if it was overtaken. Once a waiter has been kept 
+ * waiting longer than PATIENCE, barging stops until it has been served, so 
+ * the mutex falls back to being handed over directly.
+ */
+class Barging {
+
+  //! Waiters kept waiting longer than PATIENCE
+  size_t _starving;
+
+protected:
+
+  //! Microseconds a waiter may be overtaken for before it is owed the mutex
+  enum { PATIENCE = 1000 };
+
+  Barging() : _starving(0) { }
+
+  inline bool mayBarge() const { 
+    return _starving == 0; 
+  }
+
+  inline unsigned long long arrived() { 
+    return Clock::microseconds(); 
+  }
+
+  inline void overtaken(unsigned long long since, bool& starving) {
+
+    if(!starving && Clock::microseconds() - since >= PATIENCE) {
+
+      starving = true;
+      ++_starving;
+
+    }
+
+  }
+
+  inline void departed(bool starving) {
+
+    if(starving)
+      --_starving;
+
+  }
+
+};
+
 /**
  * @author Eric Crahen <http://www.code-foo.com>
  * @date <2003-07-16T19:52:12-0400>
  * @version 2.2.11
  * @class MutexImpl
  *
- * The MutexImpl template allows how waiter lists are sorted, and 
- * what actions are taken when a thread interacts with the mutex
- * to be parametized.
+ * The MutexImpl template allows how waiter lists are sorted, what
+ * actions are taken when a thread interacts with the mutex, and how
+ * a released mutex passes to the next thread to be parametized.
  */
-template <typename List, typename Behavior> 
-class MutexImpl : Behavior {
+template <typename List, typename Behavior, typename Transfer = DirectHandoff> 
+class MutexImpl : Behavior, Transfer {
 
   //! List of Events that are waiting for notification 
   List _waiters;
@@ -74,6 +147,16 @@ class MutexImpl : Behavior {
   //! Current owner
   volatile ThreadImpl* _owner;
 
+  //! Decides how long to spin before parking
+  AdaptiveSpin _spin;
+
+  bool spin(Guard<FastLock>& g);
+
+  //! Test if the mutex can be taken without waiting
+  inline bool available() {
+    return _owner == 0 && (_waiters.empty() || Transfer::mayBarge());
+  }
+
  public:
   
 
@@ -98,8 +181,8 @@ class MutexImpl : Behavior {
   /**
    * Destroy this MutexImpl and release its resources
    */
-template<typename List, typename Behavior> 
-MutexImpl<List, Behavior>::~MutexImpl() {
+template<typename List, typename Behavior, typename Transfer> 
+MutexImpl<List, Behavior, Transfer>::~MutexImpl() {
 
 #ifndef NDEBUG
 
@@ -133,8 +216,8 @@ MutexImpl<List, Behavior>::~MutexImpl() {
    * @exception Interrupted_Exception thrown when the caller status is interrupted
    * @exception Synchronization_Exception thrown if there is some other error.
    */
-template<typename List, typename Behavior> 
-void MutexImpl<List, Behavior>::acquire() {
+template<typename List, typename Behavior, typename Transfer> 
+void MutexImpl<List, Behavior, Transfer>::acquire() {
 
     ThreadImpl* self = ThreadImpl::current();
     Monitor& m = self->getMonitor();
@@ -148,8 +231,9 @@ void MutexImpl<List, Behavior>::acquire() {
     if(_owner == self) 
       throw Deadlock_Exception();
     
-    // Acquire the lock if it is free and there are no waiting threads
-    if(_owner == 0 && _waiters.empty()) {
+    // Acquire the lock if it is free and no waiting thread is owed it,
+    // or if it is freed while spinning briefly
+    if(available() || spin(g1)) {
 
       _owner = self;
 
@@ -160,30 +244,45 @@ void MutexImpl<List, Behavior>::acquire() {
     // Otherwise, wait for a signal from a thread releasing its
     // ownership of the lock
     else { 
+
+      unsigned long long since = Transfer::arrived();
+      bool starving = false;
+
+      // Wait again if another thread barged in before this one woke up
+      for(;;) {
         
-      _waiters.insert(self);
-      m.acquire();
+        _waiters.insert(self);
+        m.acquire();
 
-      Behavior::waiterArrived(self);
+        Behavior::waiterArrived(self);
 
-      {        
+        {        
       
-        Guard<FastLock, UnlockedScope> g2(g1);
-        state = m.wait();
+          Guard<FastLock, UnlockedScope> g2(g1);
+          state = m.wait();
       
-      }
+        }
 
-      Behavior::waiterDeparted(self);
+        Behavior::waiterDeparted(self);
 
-      m.release();
+        m.release();
         
-      // Remove from waiter list, regardless of wether release() is called or
-      // not. The monitor is sticky, so its possible a state 'stuck' from a
-      // previous operation and will leave the wait() w/o release() having
-      // been called (e.g. interrupted)
-      typename List::iterator i = std::find(_waiters.begin(), _waiters.end(), self);
-      if(i != _waiters.end())
-        _waiters.erase(i);
+        // Remove from waiter list, regardless of wether release() is called or
+        // not. The monitor is sticky, so its possible a state 'stuck' from a
+        // previous operation and will leave the wait() w/o release() having
+        // been called (e.g. interrupted)
+        typename List::iterator i = std::find(_waiters.begin(), _waiters.end(), self);
+        if(i != _waiters.end())
+          _waiters.erase(i);
+
+        if(state != Monitor::SIGNALED || _owner == 0)
+          break;
+
+        Transfer::overtaken(since, starving);
+
+      }
+
+      Transfer::departed(starving);
 
       // If awoke due to a notify(), take ownership. 
       switch(state) {
@@ -218,8 +317,8 @@ void MutexImpl<List, Behavior>::acquire() {
    * @exception Interrupted_Exception thrown when the caller status is interrupted
    * @exception Synchronization_Exception thrown if there is some other error.
    */
-template<typename List, typename Behavior> 
-bool MutexImpl<List, Behavior>::tryAcquire(unsigned long timeout) {
+template<typename List, typename Behavior, typename Transfer> 
+bool MutexImpl<List, Behavior, Transfer>::tryAcquire(unsigned long timeout) {
   
     ThreadImpl* self = ThreadImpl::current();
     Monitor& m = self->getMonitor();
@@ -231,8 +330,9 @@ bool MutexImpl<List, Behavior>::tryAcquire(unsigned long timeout) {
     if(_owner == self) 
       throw Deadlock_Exception();
 
-    // Acquire the lock if it is free and there are no waiting threads
-    if(_owner == 0 && _waiters.empty()) {
+    // Acquire the lock if it is free and no waiting thread is owed it,
+    // or if it is freed while spinning briefly
+    if(available() || (timeout && spin(g1))) {
 
       _owner = self;
 
@@ -244,38 +344,65 @@ bool MutexImpl<List, Behavior>::tryAcquire(unsigned long timeout) {
     // ownership of the lock
     else {
         
-      _waiters.insert(self);
-    
       Monitor::STATE state = Monitor::TIMEDOUT;
+
+      unsigned long long since = Transfer::arrived();
+      bool starving = false;
+
+      unsigned long long start = timeout ? Clock::microseconds() : 0;
+      unsigned long remaining = timeout;
+
+      // Wait again if another thread barged in before this one woke up
+      for(;;) {
+
+        _waiters.insert(self);
     
-      // Don't bother waiting if the timeout is 0
-      if(timeout) {
+        // Don't bother waiting if the timeout is 0
+        if(remaining) {
       
-        m.acquire();
+          m.acquire();
 
-        Behavior::waiterArrived(self);
+          Behavior::waiterArrived(self);
       
-        {
+          {
         
-          Guard<FastLock, UnlockedScope> g2(g1);
-          state = m.wait(timeout);
+            Guard<FastLock, UnlockedScope> g2(g1);
+            state = m.wait(remaining);
         
-        }
+          }
 
-        Behavior::waiterDeparted(self);
+          Behavior::waiterDeparted(self);
       
-        m.release();
+          m.release();
         
-      }
-    
+        }
     
-      // Remove from waiter list, regarless of weather release() is called or
-      // not. The monitor is sticky, so its possible a state 'stuck' from a
-      // previous operation and will leave the wait() w/o release() having
-      // been called.
-      typename List::iterator i = std::find(_waiters.begin(), _waiters.end(), self);
-      if(i != _waiters.end())
-        _waiters.erase(i);
+        // Remove from waiter list, regarless of weather release() is called or
+        // not. The monitor is sticky, so its possible a state 'stuck' from a
+        // previous operation and will leave the wait() w/o release() having
+        // been called.
+        typename List::iterator i = std::find(_waiters.begin(), _waiters.end(), self);
+        if(i != _waiters.end())
+          _waiters.erase(i);
+
+        if(state != Monitor::SIGNALED || _owner == 0)
+          break;
+
+        Transfer::overtaken(since, starving);
+
+        unsigned long elapsed = (unsigned long)((Clock::microseconds() - start) / 1000);
+        if(elapsed >= timeout) {
+
+          state = Monitor::TIMEDOUT;
+          break;
+
+        }
+
+        remaining = timeout - elapsed;
+
+      }
+
+      Transfer::departed(starving);
     
       // If awoke due to a notify(), take ownership. 
       switch(state) {
@@ -304,17 +431,44 @@ bool MutexImpl<List, Behavior>::tryAcquire(unsigned long timeout) {
   
   }
 
+  /**
+   * Spin with the mutex's lock released while the owner may be about to
+   * release the mutex. Spinning is pointless once other threads are parked,
+   * unless the mutex can be barged in on, as it is handed directly to one 
+   * of them.
+   *
+   * @return bool true if the mutex can be taken
+   */
+template<typename List, typename Behavior, typename Transfer> 
+bool MutexImpl<List, Behavior, Transfer>::spin(Guard<FastLock>& g1) {
+
+    if(!_waiters.empty() && !Transfer::mayBarge())
+      return false;
+
+    {
+
+      Guard<FastLock, UnlockedScope> g2(g1);
+
+      if(!_spin.spin(_owner, (volatile ThreadImpl*)0))
+        return false;
+
+    }
+
+    return available();
+
+  }
+
   /**
    * Release a lock on the mutex. If this operation succeeds the calling
    * thread no longer holds an exclusive lock on this mutex. If there are 
-   * waiting threads, one will be selected, assigned ownership and specifically 
-   * awakened.
+   * waiting threads, one will be selected and specifically awakened. It is 
+   * assigned ownership unless the Transfer policy lets another thread barge in.
    *
    * @exception InvalidOp_Exception - thrown if an attempt is made to 
    * release a mutex not owned by the calling thread.
    */
-template<typename List, typename Behavior> 
-void MutexImpl<List, Behavior>::release() {
+template<typename List, typename Behavior, typename Transfer> 
+void MutexImpl<List, Behavior, Transfer>::release() {
 
     ThreadImpl* impl = ThreadImpl::current();
 
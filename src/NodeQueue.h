@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTNODEQUEUE_H__
+#define __ZTNODEQUEUE_H__
+
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/Queue.h"
+
+#include "AtomicOps.h"
+#include "FastLock.h"
+#include "Topology.h"
+#include "TSS.h"
+
+#include <deque>
+#include <iterator>
+#include <vector>
+
+namespace ZThread {
+
+  /**
+   * @class NodeQueue
+   * @version 2.3.3
+   *
+   * A NodeQueue is a Queue implementation that keeps a separate FIFO queue for 
+   * each NUMA node of a Topology, so that items tend to be consumed on the node
+   * where they were produced.
+   *
+   * - Threads attach()ed to a node add() items to that node's queue, and next()
+   *   takes from that queue first, then from the other nodes, nearest first.
+   *
+   * - Items added by threads that are not attached go to the queue of the node
+   *   the adding thread is running on.
+   *
+   * Threads blocked by next() are parked on a Condition and are only signaled 
+   * when some thread is known to be parked.
+   *
+   * @see Queue
+   */
+  template <class T>
+    class NodeQueue : public Queue<T> {
+
+      //! Queue of a single node
+      struct Node {
+
+        //! Serialize access to the items
+        FastLock lock;
+
+        std::deque<T> items;
+
+        //! Lock free hint of the number of items
+        volatile size_t count;
+
+        //! Queue the node belongs to
+        NodeQueue* owner;
+
+        //! Position of the node in the Topology
+        size_t index;
+
+        //! Keep neighboring nodes off the same cache line
+        char pad[64];
+
+        Node(NodeQueue* q, size_t n) : count(0), owner(q), index(n) {}
+
+      };
+
+      typedef std::vector<Node*> NodeList;
+
+      //! Node the calling thread is attached to
+      static TSS<Node*> _current;
+
+      const Topology& _topology;
+
+      NodeList _nodes;
+
+      //! Serialize parking threads
+      FastMutex _idleLock;
+
+      //! Signaled when an item is added and a thread is parked
+      Condition _idle;
+
+      //! Number of items added but not yet taken
+      volatile size_t _pending;
+
+      //! Number of threads parked, or about to park, in next()
+      volatile size_t _sleepers;
+
+      //! Cancellation flag
+      volatile bool _canceled;
+
+      public:
+
+      //! Create a new NodeQueue with a queue for each node of the given Topology
+      NodeQueue(const Topology& topology) 
+        : _topology(topology), _idle(_idleLock), _pending(0), _sleepers(0), _canceled(false) {
+
+        for(size_t i = 0; i < _topology.nodes(); ++i)
+          _nodes.push_back(new Node(this, i));
+
+      }
+
+      //! Destroy a NodeQueue, delete remaining items
+      virtual ~NodeQueue() { 
+
+        for(typename NodeList::iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+          delete *i;
+
+      }
+
+      //! Number of nodes
+      size_t nodes() const {
+        return _nodes.size();
+      }
+
+      /**
+       * Attach the calling thread to a node.
+       *
+       * @param node index of the node in the Topology
+       */
+      void attach(size_t node) {
+        _current.set(_nodes[node % _nodes.size()]);
+      }
+
+      //! Detach the calling thread from its node
+      void detach() {
+
+        Node* node = _current.get();
+        if(node != 0 && node->owner == this)
+          _current.set(0);
+
+      }
+
+      /**
+       * Add a value to this Queue. 
+       *
+       * @param item value to be added to the Queue
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       *
+       * @pre  The Queue should not have been canceled prior to the invocation of this function.
+       * @post If no exception is thrown, a copy of <i>item</i> will have been added to the Queue.
+       *
+       * @see Queue::add(const T& item)
+       */
+      virtual void add(const T& item) {
+        addAll(&item, &item + 1);
+      }
+
+      /**
+       * Add a value to this Queue. 
+       *
+       * @param item value to be added to the Queue
+       * @param timeout unused, adding to a NodeQueue never blocks
+       *
+       * @return <em>true</em> 
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       *
+       * @see Queue::add(const T& item, unsigned long timeout)
+       */
+      virtual bool add(const T& item, unsigned long) {
+
+        add(item);
+        return true;
+
+      }
+
+      /**
+       * Add a range of values to the queue of the calling thread's node, taking
+       * its lock once, and waking at most one parked thread for each value added.
+       *
+       * @param begin first value to be added to the Queue
+       * @param end position after the last value to be added
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       */
+      template <class InputIterator>
+      void addAll(InputIterator begin, InputIterator end) {
+
+        size_t n = std::distance(begin, end);
+        if(n == 0)
+          return;
+
+        // Account for the items before they become visible; a canceled queue 
+        // will not stop draining while this count is non-zero
+        AtomicOps::fetchAndAdd(_pending, n);
+
+        if(AtomicOps::load(_canceled)) {
+
+          AtomicOps::fetchAndAdd(_pending, 0 - n);
+          throw Cancellation_Exception();
+
+        }
+
+        Node* node = local();
+
+        try {
+
+          Guard<FastLock> g(node->lock);
+
+          node->items.insert(node->items.end(), begin, end);
+          AtomicOps::store(node->count, node->items.size());
+
+        } catch(...) {
+
+          AtomicOps::fetchAndAdd(_pending, 0 - n);
+          throw;
+
+        }
+
+        size_t sleepers = AtomicOps::load(_sleepers);
+        if(sleepers > 0) {
+
+          Guard<FastMutex> g(_idleLock);
+
+          for(size_t i = 0; i < n && i < sleepers; ++i)
+            _idle.signal();
+
+        }
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue, preferring the calling 
+       * thread's own node.
+       *
+       * If invoked when there are no values present to return then the calling thread 
+       * will be blocked until a value arrives in the Queue.
+       *
+       * @return <em>T</em> next available value
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled
+       *            and no values remain.
+       * @exception Interrupted_Exception thrown if the thread was interrupted while waiting
+       *            to retrieve a value
+       *
+       * @post The value returned will have been removed from the Queue.
+       */
+      virtual T next() {
+
+        T item;
+
+        while(!take(item))
+          park(0);
+
+        return item;
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue.
+       *
+       * @param timeout maximum amount of time (milliseconds) this method may block
+       *        the calling thread.
+       *
+       * @return <em>T</em> next available value
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled
+       *            and no values remain.
+       * @exception Timeout_Exception thrown if the timeout expires before a value
+       *            can be retrieved.
+       *
+       * @post The value returned will have been removed from the Queue.
+       */
+      virtual T next(unsigned long timeout) {
+
+        T item;
+
+        while(!take(item))
+          if(!park(timeout == 0 ? 1 : timeout))
+            throw Timeout_Exception();
+
+        return item;
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue, if one is available, 
+       * without blocking.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryNext(T& item) {
+        return take(item);
+      }
+
+      /**
+       * Retrieve and remove one of the values that have been queued longest, 
+       * if one is available, without blocking. Nodes keep no order between 
+       * each other, so this is the front of the node with the most values.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryOldest(T& item) {
+
+        for(;;) {
+
+          Node* longest = 0;
+
+          for(typename NodeList::iterator i = _nodes.begin(); i != _nodes.end(); ++i)
+            if(AtomicOps::load((*i)->count) > 0 && 
+               (longest == 0 || AtomicOps::load((*i)->count) > AtomicOps::load(longest->count)))
+              longest = *i;
+
+          if(longest == 0)
+            return false;
+
+          // Another thread may have emptied it in the meantime
+          if(popFront(longest, item)) {
+
+            AtomicOps::decrement(_pending);
+            return true;
+
+          }
+
+        }
+
+      }
+
+      /**
+       * Cancel this queue. 
+       * 
+       * @post Any threads blocked by a next() function will throw a Cancellation_Exception
+       *       once no values remain.
+       * 
+       * @see Queue::cancel()
+       */
+      virtual void cancel() {
+
+        AtomicOps::exchange(_canceled, true);
+
+        Guard<FastMutex> g(_idleLock);
+        _idle.broadcast();
+
+      }
+
+      /**
+       * @see Queue::isCanceled()
+       */
+      virtual bool isCanceled() {
+        return AtomicOps::load(_canceled);
+      }
+
+      /**
+       * @see Queue::size()
+       */
+      virtual size_t size() {
+        return AtomicOps::load(_pending);
+      }
+
+      /**
+       * @see Queue::size(unsigned long timeout)
+       */
+      virtual size_t size(unsigned long) {
+        return size();
+      }
+
+      private:
+
+      //! Node the calling thread is attached to, or is running on
+      Node* local() {
+
+        Node* node = _current.get();
+
+        if(node == 0 || node->owner != this)
+          node = _nodes[_topology.currentNode() % _nodes.size()];
+
+        return node;
+
+      }
+
+      //! Try each node once, nearest first, without blocking
+      bool take(T& item) {
+
+        const std::vector<size_t>& order = _topology.nearest(local()->index);
+
+        for(std::vector<size_t>::const_iterator i = order.begin(); i != order.end(); ++i) 
+          if(popFront(_nodes[*i], item)) {
+
+            AtomicOps::decrement(_pending);
+            return true;
+
+          }
+
+        return false;
+
+      }
+
+      bool popFront(Node* node, T& item) {
+
+        if(AtomicOps::load(node->count) == 0)
+          return false;
+
+        Guard<FastLock> g(node->lock);
+
+        if(node->items.empty())
+          return false;
+
+        item = node->items.front();
+        node->items.pop_front();
+
+        AtomicOps::store(node->count, node->items.size());
+        return true;
+
+      }
+
+      /**
+       * Block until an item is added, or until the queue is canceled.
+       *
+       * @return false if the timeout expired.
+       */
+      bool park(unsigned long timeout) {
+
+        Guard<FastMutex> g(_idleLock);
+
+        // Announce the intent to park before checking for work, add() checks
+        // for sleepers after announcing its item
+        AtomicOps::increment(_sleepers);
+
+        bool signaled = true;
+
+        try {
+
+          if(AtomicOps::load(_pending) == 0) {
+
+            if(AtomicOps::load(_canceled))
+              throw Cancellation_Exception();
+
+            if(timeout == 0)
+              _idle.wait();
+            else
+              signaled = _idle.wait(timeout);
+
+          }
+
+        } catch(...) {
+
+          AtomicOps::decrement(_sleepers);
+          throw;
+
+        }
+
+        AtomicOps::decrement(_sleepers);
+        return signaled;
+
+      }
+
+    }; /* NodeQueue */
+
+  template <class T>
+    TSS<typename NodeQueue<T>::Node*> NodeQueue<T>::_current;
+
+} // namespace ZThread
+
+#endif // __ZTNODEQUEUE_H__
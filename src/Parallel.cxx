@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ThreadImpl.h"
+#include "zthread/Parallel.h"
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+
+#include "AtomicOps.h"
+#include "Clock.h"
+
+namespace ZThread {
+
+  namespace {
+
+    //! Chunk duration aimed for when the grain size is chosen automatically
+    const unsigned long TARGET = 100;
+
+    /**
+     * @class LoopImpl
+     *
+     * State shared by the threads working on a ParallelLoop. It is reference
+     * counted since helpers may only start running after the loop completed.
+     */
+    class LoopImpl {
+
+      //! Loop being run, only touched by threads that entered
+      ParallelLoop* _loop;
+
+      //! Next iteration to hand out
+      volatile size_t _next;
+
+      const size_t _end;
+      const size_t _grain;
+
+      //! Threads that may work on the range
+      size_t _slots;
+
+      //! Next slot for a helper
+      volatile size_t _slot;
+
+      //! Helpers working on the range
+      volatile size_t _active;
+
+      //! Set once the caller stops admitting helpers
+      volatile bool _closed;
+
+      //! Set once an iteration run by a helper threw
+      volatile bool _failed;
+
+      volatile size_t _references;
+
+      //! Signaled when the last active helper leaves
+      FastMutex _lock;
+      Condition _idle;
+
+      //! Claim the next chunk, sized by the calling thread
+      bool claim(size_t& begin, size_t& end, size_t size) {
+
+        if(AtomicOps::load(_failed))
+          return false;
+
+        begin = AtomicOps::fetchAndAdd(_next, size);
+        if(begin >= _end)
+          return false;
+
+        end = (_end - begin < size) ? _end : begin + size;
+        return true;
+
+      }
+
+    public:
+
+      LoopImpl(ParallelLoop* loop, size_t begin, size_t end, size_t grain) 
+        : _loop(loop), _next(begin), _end(end), _grain(grain), _slots(1), _slot(1), 
+          _active(0), _closed(false), _failed(false), _references(1), _idle(_lock) { }
+
+      void addReference() {
+        AtomicOps::increment(_references);
+      }
+
+      void delReference() {
+
+        if(AtomicOps::decrement(_references) == 0)
+          delete this;
+
+      }
+
+      //! Number of chunks the range splits into, at most
+      size_t chunks() const {
+
+        size_t n = _next < _end ? _end - _next : 0;
+        return _grain > 1 ? (n + _grain - 1) / _grain : n;
+
+      }
+
+      void slots(size_t n) {
+        _slots = n;
+      }
+
+      size_t slots() const {
+        return _slots;
+      }
+
+      /**
+       * Admit a helper.
+       *
+       * @return false if the caller no longer admits helpers.
+       */
+      bool enter() {
+
+        AtomicOps::increment(_active);
+
+        if(AtomicOps::load(_closed)) {
+
+          leave();
+          return false;
+
+        }
+
+        return true;
+
+      }
+
+      void leave() {
+
+        if(AtomicOps::decrement(_active) == 0) {
+
+          Guard<FastMutex> g(_lock);
+          _idle.broadcast();
+
+        }
+
+      }
+
+      //! Stop admitting helpers, and wait for those working on the range
+      void close() {
+
+        AtomicOps::exchange(_closed, true);
+
+        if(AtomicOps::load(_active) == 0)
+          return;
+
+        bool interrupted = false;
+
+        {
+
+          Guard<FastMutex> g(_lock);
+
+          // Helpers still use the loop, so an interrupt can't end the wait
+          while(AtomicOps::load(_active) > 0) {
+
+            try {
+              _idle.wait();
+            } catch(Interrupted_Exception&) {
+              interrupted = true;
+            }
+
+          }
+
+        }
+
+        // Restore the interrupted status
+        if(interrupted)
+          ThreadImpl::current()->interrupt();
+
+      }
+
+      //! Stop handing out chunks
+      void fail() {
+        AtomicOps::exchange(_failed, true);
+      }
+
+      bool failed() const {
+        return AtomicOps::load(_failed);
+      }
+
+      //! Next slot, for a helper that entered
+      size_t slot() {
+        return AtomicOps::fetchAndAdd(_slot, 1);
+      }
+
+      //! Work on the range until no chunks remain
+      void participate(size_t slot) {
+
+        size_t begin, end;
+
+        if(_grain > 0) {
+
+          while(claim(begin, end, _grain))
+            _loop->iterate(begin, end, slot);
+
+          return;
+
+        }
+
+        // Double the chunk size while chunks are fast, within a fair share of
+        // what remains
+        size_t size = 1;
+
+        while(claim(begin, end, size)) {
+
+          unsigned long long start = Clock::microseconds();
+          _loop->iterate(begin, end, slot);
+          unsigned long long elapsed = Clock::microseconds() - start;
+
+          size_t next = AtomicOps::load(_next);
+          size_t share = next < _end ? (_end - next) / (2 * _slots) : 0;
+
+          if(elapsed < TARGET)
+            size *= 2;
+          else if(elapsed > 4 * TARGET && size > 1)
+            size /= 2;
+
+          if(size > share)
+            size = share > 0 ? share : 1;
+
+        }
+
+      }
+
+    };
+
+    //! Submitted to the PoolExecutor to help with a loop
+    class Helper : public Runnable {
+
+      LoopImpl* _impl;
+
+    public:
+
+      Helper(LoopImpl* impl) : _impl(impl) {
+        _impl->addReference();
+      }
+
+      ~Helper() {
+        _impl->delReference();
+      }
+
+      void run() {
+
+        if(!_impl->enter())
+          return;
+
+        try {
+          _impl->participate(_impl->slot());
+        } catch(...) {
+          _impl->fail();
+        }
+
+        _impl->leave();
+
+      }
+
+    };
+
+    //! Run a task for each iteration
+    class InvokeLoop : public ParallelLoop {
+
+      const Task* _tasks;
+
+    public:
+
+      InvokeLoop(const Task* tasks, size_t n) 
+        : ParallelLoop(0, n, 1), _tasks(tasks) { }
+
+      virtual void iterate(size_t begin, size_t end, size_t) {
+
+        for(size_t i = begin; i < end; ++i) {
+
+          Task task(_tasks[i]);
+          task->run();
+
+        }
+
+      }
+
+    };
+
+  }
+
+  ParallelLoop::ParallelLoop(size_t begin, size_t end, size_t grain) 
+    : _impl(new LoopImpl(this, begin, end, grain)) { }
+
+  ParallelLoop::~ParallelLoop() {
+    _impl->delReference();
+  }
+
+  void ParallelLoop::run(PoolExecutor& executor) {
+
+    // No point in more helpers than there are chunks, besides the caller's
+    size_t chunks = _impl->chunks();
+    size_t helpers = executor.size();
+
+    if(chunks <= 1)
+      helpers = 0;
+    else if(helpers > chunks - 1)
+      helpers = chunks - 1;
+
+    _impl->slots(helpers + 1);
+    start(helpers + 1);
+
+    if(helpers > 0) {
+
+      try {
+
+        std::vector<Task> batch;
+        batch.reserve(helpers);
+
+        for(size_t i = 0; i < helpers; ++i)
+          batch.push_back(Task(new Helper(_impl)));
+
+        executor.executeBatch(&batch[0], batch.size());
+
+      } catch(Synchronization_Exception&) {
+
+        // The executor was canceled, the caller runs the loop alone
+
+      }
+
+    }
+
+    try {
+
+      _impl->participate(0);
+
+    } catch(...) {
+
+      _impl->fail();
+      _impl->close();
+
+      throw;
+
+    }
+
+    _impl->close();
+
+    if(_impl->failed())
+      throw Synchronization_Exception("An iteration of a parallel loop threw an exception");
+
+  }
+
+  void parallelInvoke(PoolExecutor& executor, const Task* tasks, size_t n) {
+
+    InvokeLoop loop(tasks, n);
+    loop.run(executor);
+
+  }
+
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b) {
+
+    Task tasks[] = { a, b };
+    parallelInvoke(executor, tasks, 2);
+
+  }
+
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b, const Task& c) {
+
+    Task tasks[] = { a, b, c };
+    parallelInvoke(executor, tasks, 3);
+
+  }
+
+  void parallelInvoke(PoolExecutor& executor, const Task& a, const Task& b, const Task& c, const Task& d) {
+
+    Task tasks[] = { a, b, c, d };
+    parallelInvoke(executor, tasks, 4);
+
+  }
+
+} // namespace ZThread
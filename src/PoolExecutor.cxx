@@ -22,14 +22,26 @@
 
 #include "ThreadImpl.h"
 #include "zthread/PoolExecutor.h"
-#include "zthread/MonitoredQueue.h"
+#include "zthread/Condition.h"
 #include "zthread/FastMutex.h"
+#include "zthread/Time.h"
 #include "ThreadImpl.h"
+#include "Clock.h"
+#include "Discardable.h"
+#include "LevelQueue.h"
+#include "NodeQueue.h"
 #include "ThreadQueue.h"
+#include "TokenImpl.h"
+#include "Topology.h"
+#include "WaiterQueue.h"
+#include "WorkSignal.h"
+#include "WorkStealingQueue.h"
 
 #include <algorithm>
 #include <deque>
+#include <list>
 #include <utility>
+#include <vector>
 
 using namespace ZThread;
 
@@ -38,468 +50,1636 @@ namespace ZThread {
   namespace {
 
     /**
+     * @class ExecutorTask
+     * 
+     * Wrap a task with group and generation information. 
+     *
+     * - 'group' is the WaiterQueue epoch the task is counted in, so that 
+     *   waiting threads know when it has completed.
+     *
+     * - 'generation' allows tasks to be interrupted  
+     *
+     * - 'token' is the CancellationToken the task was submitted with, if any
+     *
+     * - 'deadline' is the tick the task should complete by, if it has one
+     *
+     * ExecutorTasks are queued by value, so submitting a task does not allocate
+     * anything beyond the queue's own storage. A plain function and its argument
+     * can be stored in place of a Task, so that submitting it does not allocate
+     * at all.
+     */
+    class ExecutorTask {
+
+      //! Task to run, empty when a function is queued
+      CountedPtr<Runnable, AtomicCount> _task;
+
+      //! Shared state of the task's CancellationToken, empty if it has none
+      CountedPtr<TokenImpl, AtomicCount> _token;
+
+      void (*_function)(void*);
+      void* _argument;
+
+      WaiterQueue* _queue;
+
+      size_t _group;
+      size_t _generation;
+
+      //! Tick the task was submitted at, only kept by an elastic pool
+      unsigned long _submitted;
+
+      //! Tick the task should complete by, when _timed is set
+      unsigned long _deadline;
+      bool _timed;
+
+#if !defined(ZTHREAD_DISABLE_METRICS)
+
+      //! Clock::microseconds() the task was queued at
+      unsigned long long _enqueued;
+
+#endif
+
+    public:
+
+      //! Ticket from WaiterQueue::increment() 
+      typedef std::pair<size_t, size_t> Ticket;
+
+      ExecutorTask() 
+        : _function(0), _argument(0), _queue(0), _group(0), _generation(0), _submitted(0),
+          _deadline(0), _timed(false)
+#if !defined(ZTHREAD_DISABLE_METRICS)
+          , _enqueued(0)
+#endif
+          { }
+
+      ExecutorTask(const Task& task, WaiterQueue& queue, const Ticket& ticket)
+        : _task(task), _function(0), _argument(0), _queue(&queue), 
+          _group(ticket.first), _generation(ticket.second), _submitted(0),
+          _deadline(0), _timed(false)
+#if !defined(ZTHREAD_DISABLE_METRICS)
+          , _enqueued(0)
+#endif
+          { }
+
+      ExecutorTask(const Task& task, const CountedPtr<TokenImpl, AtomicCount>& token, 
+                   WaiterQueue& queue, const Ticket& ticket)
+        : _task(task), _token(token), _function(0), _argument(0), _queue(&queue), 
+          _group(ticket.first), _generation(ticket.second), _submitted(0),
+          _deadline(0), _timed(false)
+#if !defined(ZTHREAD_DISABLE_METRICS)
+          , _enqueued(0)
+#endif
+          { }
+
+      ExecutorTask(void (*function)(void*), void* argument, WaiterQueue& queue, const Ticket& ticket)
+        : _function(function), _argument(argument), _queue(&queue), 
+          _group(ticket.first), _generation(ticket.second), _submitted(0),
+          _deadline(0), _timed(false)
+#if !defined(ZTHREAD_DISABLE_METRICS)
+          , _enqueued(0)
+#endif
+          { }
+
+      size_t group() const {
+        return _group;
+      }
+
+      size_t generation() const {
+        return _generation;
+      }
+
+      unsigned long submitted() const {
+        return _submitted;
+      }
+
+      void submitted(unsigned long tick) {
+        _submitted = tick;
+      }
+
+      bool timed() const {
+        return _timed;
+      }
+
+      unsigned long deadline() const {
+        return _deadline;
+      }
+
+      void deadline(unsigned long tick) {
+
+        _deadline = tick;
+        _timed    = true;
+
+      }
+
+      //! Test whether the task has a deadline that passed before the given tick
+      bool late(unsigned long tick) const {
+        return _timed && (long)(tick - _deadline) > 0;
+      }
+
+      //! Task to run, empty when a function is queued
+      Task task() const {
+        return Task(_task);
+      }
+
+#if !defined(ZTHREAD_DISABLE_METRICS)
+
+      unsigned long long enqueued() const {
+        return _enqueued;
+      }
+
+      void enqueued(unsigned long long time) {
+        _enqueued = time;
+      }
+
+#endif
+
+      //! Test whether the task's token has been canceled, with a plain load
+      bool canceled() {
+        return _token && _token->isCanceled();
+      }
+
+      void run() {
+
+        invoke();
+        finish();
+
+      }
+
+      /**
+       * Run the task, ignoring any exception it throws. A task whose token is
+       * canceled is dropped, and the thread is only interrupted by its token
+       * while it runs the task.
+       *
+       * @return false if the task was dropped
+       */
+      bool invoke() {
+
+        if(_token && !_token->enter())
+          return false;
+
+        try {
+
+          if(_function)
+            _function(_argument);
+          else
+            _task->run();
+
+        } catch(...) {
+
+        }
+
+        if(_token) {
+
+          _token->leave();
+
+          // Don't leave an interrupt meant for the task to the next one
+          if(_token->isCanceled())
+            ThreadImpl::current()->isInterrupted();
+
+        }
+
+        return true;
+
+      }
+
+      //! Count the task as completed for waiting threads
+      void finish() {
+        _queue->decrement( group() );
+      }
+
+      //! Count a task dropped without running as completed, telling it if it asks
+      void discard() {
+
+        if(_task) {
+
+          Discardable* d = dynamic_cast<Discardable*>(&*_task);
+
+          if(d) {
+
+            try {
+              d->discard();
+            } catch(...) { }
+
+          }
+
+        }
+
+        finish();
+
+      }
+
+    };
+
+    /**
+     * @class WorkerStats
+     *
+     * Metrics collected by one worker. Only the worker updates them, so no
+     * atomic operations are needed; a snapshot reads them as they are.
+     */
+    class WorkerStats {
+    public:
+
+      //! Clock::microseconds() the worker started at
+      unsigned long long started;
+
+      WorkerMetrics metrics;
+
+      LatencyHistogram queueWait;
+      LatencyHistogram runTime;
+
+      WorkerStats() : started(Clock::microseconds()) { }
+
+      //! Count a task, with the time it waited and ran, and the processor time it used
+      void record(unsigned long long wait, unsigned long long run, unsigned long long cpu) {
+
+        queueWait.add(wait);
+        runTime.add(run);
+
+        ++metrics.completed;
+        metrics.busy += run;
+        metrics.cpu  += cpu;
+
+      }
+
+      //! Metrics with the idle time worked out as of the given time
+      WorkerMetrics current(unsigned long long now) const {
+
+        WorkerMetrics m(metrics);
+        unsigned long long lifetime = now > started ? now - started : 0;
+
+        m.idle = lifetime > m.busy ? lifetime - m.busy : 0;
+        return m;
+
+      }
+
+    };
+
+    /**
+     * @class HillClimber
+     *
+     * Looks for the number of workers that completes the most tasks per second. 
+     * Throughput is sampled over fixed intervals; after each interval the number 
+     * of workers moves one step in the same direction if throughput improved, 
+     * and one step in the other direction if it did not.
      */
-    class WaiterQueue {
+    class HillClimber {
+
+      //! Length of a sample (milliseconds)
+      unsigned long _interval;
+
+      //! Start of the current sample
+      unsigned long _start;
+
+      //! Tasks completed at the start of the current sample
+      size_t _count;
+
+      //! Tasks per second over the last sample
+      size_t _rate;
+
+      int _direction;
+
+    public:
+
+      HillClimber(unsigned long interval) 
+        : _interval(interval), _start(0), _count(0), _rate(0), _direction(1) { }
+
+      void reset(unsigned long now, size_t completed) {
+
+        _start = now;
+        _count = completed;
+        _rate = 0;
+        _direction = 1;
+
+      }
+
+      //! Tick at which the current sample ends
+      unsigned long end() const {
+        return _start + _interval;
+      }
+
+      /**
+       * End the current sample.
+       *
+       * @return the step to take, 1 to add a worker or -1 to remove one
+       */
+      int sample(unsigned long now, size_t completed) {
+
+        size_t rate = (completed - _count) * 1000 / (now - _start + 1);
+
+        if(rate < _rate)
+          _direction = -_direction;
+
+        _rate = rate;
+        _start = now;
+        _count = completed;
+
+        return _direction;
+
+      }
+
+    };
+
+    /**
+     *
+     */
+    class ExecutorImpl {
+      
+      typedef Queue<ExecutorTask> TaskQueue;
+      typedef LevelQueue<ExecutorTask> SharedTaskQueue;
+      typedef WorkStealingQueue<ExecutorTask> StealingTaskQueue;
+      typedef NodeQueue<ExecutorTask> NodeTaskQueue;
+      typedef std::deque<ThreadImpl*> ThreadList;
+      typedef std::list<WorkerStats> StatsList;
+
+      //! Serialize access to the worker list
+      FastMutex   _lock;
+
+      //! Queue the tasks are drawn from
+      TaskQueue*  _taskQueue;
+
+      //! Notified once tasks are queued, wakes threads helping through a TaskGroup
+      CountedPtr< WorkSignal > _work;
+
+      //! Set when all workers share the task queue, which orders tasks by priority
+      SharedTaskQueue* _sharedQueue;
+
+      //! Set when the task queue gives each worker its own deque
+      StealingTaskQueue* _stealingQueue;
+
+      //! Set when the task queue keeps a queue for each NUMA node
+      NodeTaskQueue* _nodeQueue;
+
+      WaiterQueue _waitingQueue;
+
+      ThreadList      _threads;
+      volatile size_t _size;
+
+      //! Number of registered workers, mirrors _threads.size()
+      volatile size_t _running;
+
+      //! Bounds on the number of workers
+      size_t _minimum;
+      size_t _maximum;
+
+      //! Set when the number of workers adapts to the load
+      bool _elastic;
+
+      //! Idle time (milliseconds) after which a worker above the minimum retires
+      unsigned long _keepAlive;
+
+      //! Queued tasks that cause a worker to be added when none is idle
+      size_t _backlog;
+
+      //! Time (milliseconds) a task may wait in the queue before a worker is added
+      unsigned long _age;
+
+      //! Workers blocked waiting for a task
+      volatile size_t _idle;
+
+      //! Workers added but not yet registered
+      volatile size_t _starting;
+
+      //! Tasks waiting in the queue
+      volatile size_t _queued;
+
+      //! Set when the number of workers is tuned for throughput
+      bool _tuning;
+
+      HillClimber _climber;
+
+      //! Tasks completed, while tuning
+      volatile size_t _completed;
+
+      //! Tick the current throughput sample ends at
+      volatile unsigned long _sampleEnd;
+
+      //! Polls made by an idle worker, pausing between them, before it yields
+      size_t _spins;
+
+      //! Polls made by an idle worker, yielding between them, before it blocks
+      size_t _yields;
+
+      //! Workers allowed to poll at the same time
+      size_t _spinLimit;
+
+      //! Workers polling for a task
+      volatile size_t _spinners;
+
+      //! Copy of the system's Topology, which workers may consult while the program exits
+      const Topology _topology;
+
+      //! Where workers are allowed to run
+      PoolExecutor::Placement _placement;
+
+      //! Processors workers are bound to, when given explicitly
+      std::vector<size_t> _cpuSet;
+
+      //! Incremented each time the placement changes
+      volatile size_t _placementVersion;
+
+      //! Workers placed so far, used to spread them round robin
+      size_t _placed;
+
+      //! Metrics of the running workers, serialized by _lock
+      StatsList _stats;
+
+      //! Metrics of the workers that have exited, serialized by _lock
+      WorkerStats _retired;
+
+      //! Metrics of tasks run by other threads through runQueued()
+      FastMutex _helperLock;
+      WorkerStats _helpers;
+
+      //! Tasks accepted
+      volatile size_t _accepted;
+
+      //! Tasks dropped because their token was canceled
+      volatile size_t _dropped;
+
+      //! Set when tasks whose deadline passed before they started are dropped
+      volatile bool _dropExpired;
+
+      //! Called with each task dropped because its deadline passed
+      void (*_expiredHandler)(const Task&, void*);
+      void* _expiredArgument;
+
+      //! Tasks dropped because their deadline passed
+      volatile size_t _expired;
+
+      //! Tasks that completed after their deadline
+      volatile size_t _missed;
+
+      //! Tasks queued, or about to be, and not yet drawn
+      volatile size_t _depth;
+
+      //! Most tasks that may be queued, 0 for no limit
+      volatile size_t _capacity;
+
+      //! What happens to tasks submitted while the queue is full
+      PoolExecutor::OverflowPolicy _overflow;
+
+      //! Longest time (milliseconds) to Block for room, 0 for no limit
+      unsigned long _overflowTimeout;
+
+      //! Threads blocked waiting for room, signaled through _room
+      volatile size_t _blocked;
+      FastMutex _roomLock;
+      Condition _room;
+
+      //! Tasks rejected, or whose submitter timed out, on a full queue
+      volatile size_t _rejected;
+
+      //! Tasks discarded to make room
+      volatile size_t _discarded;
+
+      //! Record the time tasks are queued at, for their metrics
+      void enqueuing(ExecutorTask* tasks, size_t n) {
+
+#if !defined(ZTHREAD_DISABLE_METRICS)
+
+        unsigned long long now = Clock::microseconds();
+
+        for(size_t i = 0; i < n; ++i)
+          tasks[i].enqueued(now);
+
+#endif
+
+      }
+
+      //! Count tasks that were queued
+      void enqueued(size_t n) {
+
+#if !defined(ZTHREAD_DISABLE_METRICS)
+        AtomicOps::fetchAndAdd(_accepted, n);
+#endif
+
+      }
+
+      //! Stamp and count tasks being submitted to an elastic pool
+      void submitting(ExecutorTask& task) {
+
+        if(_age > 0)
+          task.submitted(currentTick());
+
+      }
+
+    public:
+      
+      ExecutorImpl(PoolExecutor::Scheduling scheduling, const CountedPtr< WorkSignal >& work) 
+        : _work(work), _sharedQueue(0), _stealingQueue(0), _nodeQueue(0), _size(0), _running(0), 
+          _minimum(0), _maximum(0), _elastic(false), _keepAlive(0), _backlog(1), _age(10), 
+          _idle(0), _starting(0), _queued(0), _tuning(false), _climber(500), 
+          _completed(0), _sampleEnd(0), _spins(0), _yields(0), _spinLimit(0), _spinners(0), 
+          _topology(Topology::instance()), _placement(PoolExecutor::Floating), 
+          _placementVersion(0), _placed(0), _accepted(0), _dropped(0), 
+          _dropExpired(false), _expiredHandler(0), _expiredArgument(0), _expired(0), _missed(0), 
+          _depth(0), _capacity(0), _overflow(PoolExecutor::Block), _overflowTimeout(0), 
+          _blocked(0), _room(_roomLock), _rejected(0), _discarded(0) {
+
+        if(scheduling == PoolExecutor::WorkStealing)
+          _taskQueue = _stealingQueue = new StealingTaskQueue();
+        else if(scheduling == PoolExecutor::NodeLocal)
+          _taskQueue = _nodeQueue = new NodeTaskQueue(_topology);
+        else
+          _taskQueue = _sharedQueue = new SharedTaskQueue();
+
+      }
+
+      ~ExecutorImpl() {
+        delete _taskQueue;
+      }
+
+      /**
+       * Register the calling worker.
+       *
+       * @return the position of the worker, used to place it
+       */
+      size_t registerThread() {
+        
+        Guard<FastMutex> g(_lock);
+
+        size_t index = _placed++;
+
+        ThreadImpl* impl = ThreadImpl::current();
+        _threads.push_back(impl);
+
+        AtomicOps::store(_running, _threads.size());
+
+        if(_starting > 0)
+          AtomicOps::decrement(_starting);
+
+        // current cancel if too many threads are being created
+        if(_threads.size() > _size) 
+          impl->cancel();
+
+        // Give the worker its own deque
+        else if(_stealingQueue)
+          _stealingQueue->attach();
+
+        // Spread workers over the nodes
+        else if(_nodeQueue)
+          _nodeQueue->attach(index % _nodeQueue->nodes());
+
+        return index;
+
+      }
+
+      void unregisterThread() {
+
+        Guard<FastMutex> g(_lock);
+        _threads.erase(std::remove(_threads.begin(), _threads.end(), ThreadImpl::current()), _threads.end());
+
+        AtomicOps::store(_running, _threads.size());
+
+        if(_stealingQueue)
+          _stealingQueue->detach();
+
+        if(_nodeQueue)
+          _nodeQueue->detach();
+
+      }
+
+      void placement(PoolExecutor::Placement placement, const std::vector<size_t>& cpus) {
+
+        Guard<FastMutex> g(_lock);
+
+        _placement = placement;
+        _cpuSet    = cpus;
+
+        // Workers move themselves before they take their next task
+        AtomicOps::increment(_placementVersion);
+
+      }
+
+      //! Test whether the placement changed since the calling worker was placed
+      bool misplaced(size_t version) {
+        return AtomicOps::load(_placementVersion) != version;
+      }
+
+      /**
+       * Bind the calling worker to the processors it should run on.
+       *
+       * @param index position of the worker
+       * @return the version of the placement applied
+       */
+      size_t place(size_t index) {
+
+        PoolExecutor::Placement placement;
+        std::vector<size_t> cpus;
+        size_t version;
+
+        {
+
+          Guard<FastMutex> g(_lock);
+
+          placement = _placement;
+          cpus      = _cpuSet;
+          version   = _placementVersion;
+
+        }
+
+        const Topology& topology = _topology;
+        size_t nodes = topology.nodes();
+
+        // A worker of a node local pool stays on the node whose queue it serves
+        bool local = _nodeQueue != 0;
+        size_t node = index % nodes;
+
+        switch(placement) {
+
+          case PoolExecutor::PerCore: {
+
+            const std::vector<size_t>& all = local ? topology.cpus(node) : topology.cpus();
+            size_t n = local ? index / nodes : index;
+
+            cpus.assign(1, all[n % all.size()]);
+            break;
+
+          }
+
+          case PoolExecutor::PerNode:
+            cpus = topology.cpus(node);
+            break;
+
+          case PoolExecutor::CpuSet:
+            break;
+
+          case PoolExecutor::Floating:
+          default:
+
+            if(local)
+              cpus = topology.cpus(node);
+
+            // Undo an earlier placement
+            else if(version > 0)
+              cpus = topology.cpus();
+
+        }
+
+        if(!cpus.empty())
+          ThreadOps::setAffinity(cpus);
+
+        return version;
+
+      }
+
+      void execute(ExecutorTask& task, Priority priority = Medium) {
+
+        try {
+
+          enqueuing(&task, 1);
+
+          // Make room for the task, or run it here
+          if(!admit(1)) {
+
+            enqueued(1);
+            run(task, 0);
+
+            return;
+
+          }
+
+          if(_elastic) {
+
+            submitting(task);
+            AtomicOps::increment(_queued);
+
+          }
+          
+          try {
+
+            // Only the shared queue orders tasks by deadline, the others 
+            // still drop them once expired
+            if(_sharedQueue && task.timed())
+              _sharedQueue->addByDeadline(task, task.deadline());
+            else if(_sharedQueue)
+              _sharedQueue->add(task, priority);
+            else
+              _taskQueue->add(task);
+
+            enqueued(1);
+            _work->notify();
+
+          } catch(...) {
+
+            if(_elastic)
+              AtomicOps::decrement(_queued);
+
+            release(1);
+            throw;
+
+          }
+
+        } catch(...) {
+
+          // Incase the queue is canceled between the time the WaiterQueue is 
+          // updated and the task is added to the TaskQueue
+          _waitingQueue.decrement( task.group() );
+          throw;
+
+        }
+
+      }
+
+      void execute(const Task& task, Priority priority = Medium) {
+
+        ExecutorTask t(task, _waitingQueue, _waitingQueue.increment());
+        execute(t, priority);
+
+      }
+
+      void execute(const Task& task, const CountedPtr<TokenImpl, AtomicCount>& token, Priority priority) {
+
+        ExecutorTask t(task, token, _waitingQueue, _waitingQueue.increment());
+        execute(t, priority);
+
+      }
+
+      void execute(const Task& task, unsigned long deadline) {
+
+        ExecutorTask t(task, _waitingQueue, _waitingQueue.increment());
+        t.deadline(deadline);
+
+        execute(t);
+
+      }
+
+      void expiry(PoolExecutor::ExpiryPolicy policy, void (*handler)(const Task&, void*), void* argument) {
+
+        Guard<FastMutex> g(_lock);
+
+        _expiredHandler  = handler;
+        _expiredArgument = argument;
+
+        AtomicOps::exchange(_dropExpired, policy == PoolExecutor::DropExpired);
+
+      }
+
+      void priorities(PoolExecutor::PriorityPolicy policy, size_t aging, size_t burst) {
+
+        if(_sharedQueue)
+          _sharedQueue->policy(policy == PoolExecutor::Weighted ? SharedTaskQueue::Weighted : SharedTaskQueue::Strict, 
+                               aging, burst);
+
+      }
+
+      void weights(size_t low, size_t medium, size_t high) {
+
+        if(_sharedQueue)
+          _sharedQueue->weights(low, medium, high);
+
+      }
+
+      void execute(void (*function)(void*), void* argument) {
+
+        ExecutorTask t(function, argument, _waitingQueue, _waitingQueue.increment());
+        execute(t);
+
+      }
+
+      void execute(const Task* tasks, size_t n) {
+
+        if(n == 0)
+          return;
+
+        // Count the whole batch at once, making it a single group for wait()
+        ExecutorTask::Ticket ticket( _waitingQueue.increment(n) );
+
+        try {
+
+          std::vector<ExecutorTask> batch;
+          batch.reserve(n);
+
+          for(size_t i = 0; i < n; ++i)
+            batch.push_back( ExecutorTask(tasks[i], _waitingQueue, ticket) );
+
+          enqueuing(&batch[0], n);
+
+          // Make room for the whole batch, or run it here
+          if(!admit(n)) {
+
+            enqueued(n);
+
+            for(size_t i = 0; i < n; ++i)
+              run(batch[i], 0);
+
+            return;
+
+          }
+
+          try {
+
+            if(_elastic) {
+
+              for(size_t i = 0; i < n; ++i)
+                submitting(batch[i]);
+
+              AtomicOps::fetchAndAdd(_queued, n);
+
+            }
+
+            if(_stealingQueue)
+              _stealingQueue->addAll(batch.begin(), batch.end());
+            else if(_nodeQueue)
+              _nodeQueue->addAll(batch.begin(), batch.end());
+            else
+              _sharedQueue->addAll(batch.begin(), batch.end());
+
+            enqueued(n);
+            _work->notify();
+
+          } catch(...) {
+
+            if(_elastic)
+              AtomicOps::fetchAndAdd(_queued, 0 - n);
+
+            release(n);
+            throw;
+
+          }
+
+        } catch(...) {
+
+          _waitingQueue.decrement(ticket.first, n);
+          throw;
+
+        }
+
+      }
+
+      void interrupt() {
+
+        // Bump the generation number
+        _waitingQueue.generation(true);
+
+        Guard<FastMutex> g(_lock);
+        
+        // Interrupt all threads currently running, thier tasks would be
+        // from an older generation
+        for(ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+          (*i)->interrupt();
+       
+      }
+
+      //! Adjust the number of desired workers and return the number of Threads needed
+      size_t workers(size_t n) {
+        
+        Guard<FastMutex> g(_lock);
+
+        if(!_elastic)
+          _minimum = _maximum = n;
+
+        else if(n < _minimum || n > _maximum)
+          throw InvalidOp_Exception();
+
+        size_t m = (_size < n) ? (n - _size) : 0;
+        _size = n;
+        
+        return m;
+
+      }
+
+      //! Let the number of workers vary between the given bounds
+      void elastic(size_t minimum, size_t maximum, unsigned long keepAlive) {
+
+        Guard<FastMutex> g(_lock);
+
+        _minimum   = minimum;
+        _maximum   = maximum;
+        _keepAlive = keepAlive;
+        _elastic   = true;
+
+      }
+
+      void growth(size_t backlog, unsigned long age) {
+
+        Guard<FastMutex> g(_lock);
+
+        _backlog = backlog;
+        _age     = age;
+
+      }
+
+      void tuning(bool enabled) {
+
+        Guard<FastMutex> g(_lock);
+
+        _tuning = enabled && _elastic;
+
+        unsigned long now = currentTick();
+        _climber.reset(now, AtomicOps::load(_completed));
+
+        AtomicOps::store(_sampleEnd, _climber.end());
+
+      }
+
+      /**
+       * Test whether an elastic pool needs another worker, because tasks are 
+       * queued, or a task waited too long, while no worker is idle.
+       *
+       * @param task task that was just drawn from the queue, if any
+       */
+      bool backlogged(const ExecutorTask* task = 0) {
+
+        if(!_elastic || AtomicOps::load(_idle) + AtomicOps::load(_starting) > 0)
+          return false;
 
-      typedef std::deque<ThreadImpl*>  ThreadList;
-      
-      typedef struct group_t {
-        size_t     id;
-        size_t     count;
-        ThreadList waiters;
-        group_t(size_t n) : id(n), count(0) {}
-      } Group;
-
-      typedef std::deque<Group>  GroupList;
-
-      //! Predicate to find a specific group
-      struct by_id : public std::unary_function<bool, Group> {
-        size_t id;
-        by_id(size_t n) : id(n) {}
-        bool operator()(const Group& grp) {
-          return grp.id == id;
-        }
-      };
-
-      //! Functor to count groups
-      struct counter : public std::unary_function<void, Group> {
-        size_t count;
-        counter() : count(0) {}
-        void operator()(const Group& grp) { count += grp.count; }
-        operator size_t() { return count; }
-      };
-      
-      FastMutex     _lock;
-      GroupList _list;
-      size_t    _id;
-      size_t    _generation;
+        if(task == 0)
+          return AtomicOps::load(_queued) >= _backlog;
+
+        return _age > 0 && (long)(currentTick() - task->submitted()) >= (long)_age;
+
+      }
+
+      //! Reserve a new worker, unless the pool is at its maximum size
+      bool grow() {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_size >= _maximum)
+          return false;
+
+        ++_size;
+        AtomicOps::increment(_starting);
+
+        return true;
+
+      }
+
+      //! Release a worker reserved by grow() that could not be started
+      void abandon() {
+
+        Guard<FastMutex> g(_lock);
+
+        --_size;
+
+        if(_starting > 0)
+          AtomicOps::decrement(_starting);
 
-    public:
-      
-      WaiterQueue() : _id(0), _generation(0) {
-        // At least one empty-group exists
-        _list.push_back( Group(_id++) );
       }
 
       /**
-       * Insert the current thread into the current waiter list
+       * Count a completed task and, while tuning, take a step towards the 
+       * number of workers with the best throughput.
        *
-       * @pre  At least one empty group exists
-       * @post At least one empty group exists
+       * @return true if a worker should be added
        */
-      bool wait(unsigned long timeout) {
+      bool completed() {
+
+        if(!_tuning)
+          return false;
 
-		ThreadImpl* current = ThreadImpl::current();
-        Monitor& m = current->getMonitor();
+        size_t n = AtomicOps::increment(_completed);
+        unsigned long now = currentTick();
 
-        Monitor::STATE state;
+        if((long)(now - AtomicOps::load(_sampleEnd)) < 0)
+          return false;
 
-        Guard<FastMutex> g1(_lock);
+        Guard<FastMutex> g(_lock);
+
+        if((long)(now - _sampleEnd) < 0)
+          return false;
+
+        int step = _climber.sample(now, n);
+        AtomicOps::store(_sampleEnd, _climber.end());
+
+        // Only add a worker when there is work waiting for it; a worker that is 
+        // no longer needed retires once it finishes its task
+        if(step > 0 && _size < _maximum && AtomicOps::load(_queued) > 0) {
 
-        // At least one empty-group exists
-        assert(!_list.empty());
+          ++_size;
+          AtomicOps::increment(_starting);
 
-        // Return w/o waiting if there are no executing tasks
-        if((size_t)std::for_each(_list.begin(), _list.end(), counter()) < 1)
           return true;
 
-        // Update the waiter list for the active group 
-        _list.back().waiters.push_back(current);
-        size_t n = _list.back().id;
+        } else if(step < 0 && _size > _minimum) 
+          --_size;
+
+        return false;
+
+      }
+
+      //! Test whether the calling worker is no longer needed, and should retire
+      bool surplus() {
 
-        m.acquire();
+        if(AtomicOps::load(_running) <= AtomicOps::load(_size))
+          return false;
+
+        Guard<FastMutex> g(_lock);
+
+        if(_threads.size() <= _size)
+          return false;
+
+        _threads.erase(std::remove(_threads.begin(), _threads.end(), ThreadImpl::current()), _threads.end());
+        AtomicOps::store(_running, _threads.size());
+
+        return true;
+
+      }
+
+      //! Retire an idle worker if the pool is above its minimum size
+      bool retire() {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_size <= _minimum)
+          return false;
+
+        --_size;
+        return true;
+
+      }
+      
+      size_t workers() {
         
-        {
+        Guard<FastMutex> g(_lock);
+        return _size;
+        
+      }
+      
+      void spinning(size_t spins, size_t yields, size_t spinners) {
+
+        Guard<FastMutex> g(_lock);
+
+        _spins     = spins;
+        _yields    = yields;
+        _spinLimit = spinners;
+
+      }
+
+      //! Test, without blocking, whether a task appears to be queued
+      bool available() {
+
+        if(_sharedQueue)
+          return _sharedQueue->available();
+
+        // Lock free for the other queues
+        return _taskQueue->size() > 0;
 
-          Guard<FastMutex, UnlockedScope> g2(g1);          
-          state = timeout == 0 ? m.wait() : m.wait(timeout);
+      }
+
+      /**
+       * Poll for a task for a short while before blocking, so that a task 
+       * submitted soon after the queue empties is handed over without waking 
+       * a blocked thread. Only a bounded number of workers poll at a time, the 
+       * others block right away.
+       */
+      void spin() {
+
+        if(_spins + _yields == 0)
+          return;
+
+        // Claim one of the polling slots
+        for(;;) {
+
+          size_t n = AtomicOps::load(_spinners);
+          if(n >= _spinLimit)
+            return;
+
+          if(AtomicOps::cas(_spinners, n, n + 1))
+            break;
 
         }
 
-        m.release();
+        // A polling worker is idle as far as an elastic pool is concerned
+        AtomicOps::increment(_idle);
 
-        // If awoke due to a reason other than the last task in the group 'n' completing,
-        // then then find the group 'current' is waiting in
-        GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-        if(i != _list.end()) {
+        bool found = available();
 
-          // Remove 'current' from that list if it is still a member
-          ThreadList::iterator j = std::find(i->waiters.begin(), i->waiters.end(), current);
-          if(j != i->waiters.end())
-            i->waiters.erase(j);
+        for(size_t i = 0; !found && i < _spins; ++i) {
+
+          AtomicOps::pause();
+          found = available();
 
         }
 
-        // At least one empty-group exists
-        assert(!_list.empty());
+        for(size_t i = 0; !found && i < _yields; ++i) {
+
+          Thread::yield();
+          found = available();
+
+        }
+
+        AtomicOps::decrement(_idle);
+        AtomicOps::decrement(_spinners);
+
+      }
+
+      /**
+       * Wait for a task as an idle worker.
+       *
+       * @return false if the keep-alive time expired first.
+       */
+      bool take(ExecutorTask& task) {
+
+        AtomicOps::increment(_idle);
+
+        try {
+
+          if(_keepAlive == 0)
+            task = _taskQueue->next();
+          else
+            task = _taskQueue->next(_keepAlive);
+
+        } catch(Timeout_Exception&) {
+
+          AtomicOps::decrement(_idle);
+          return false;
+
+        } catch(...) {
+
+          AtomicOps::decrement(_idle);
+          throw;
+
+        }
+
+        AtomicOps::decrement(_idle);
+        AtomicOps::decrement(_queued);
 
-        switch(state) {
-          case Monitor::SIGNALED:
-            break;
-          case Monitor::TIMEDOUT:
-            return false;
-          case Monitor::INTERRUPTED:
-            throw Interrupted_Exception();
-          default:
-            throw Synchronization_Exception();
-        } 
-       
         return true;
 
       }
-      
+
       /**
-       * Increment the active group count
+       * Draw the next task.
        *
-       * @pre at least 1 empty group exists
-       * @post at least 1 non-empty group exists 
+       * @return false if the calling worker should retire.
        */
-      std::pair<size_t, size_t> increment() {
+      bool next(ExecutorTask& task) {
         
-        Guard<FastMutex> g(_lock);
+        // Draw the task from the queue
+        for(;;) {
+
+          if(surplus())
+            return false;
+
+          try { 
+
+            spin();
+
+            if(!_elastic)
+              task = _taskQueue->next();
+
+            else if(!take(task)) {
+
+              // Idle too long, retire when above the minimum size
+              retire();
+              continue;
+
+            }
+
+            drawn(1);
+
+            // Drop a task whose token was canceled while it was queued
+            if(!dropped(task))
+              break;
+
+          } catch(Interrupted_Exception&) {
+
+            // Ignore interruption here, it can only come from
+            // another thread interrupt()ing the executor. The
+            // thread was interrupted in the hopes it was busy 
+            // with a task
+
+          }
+
+        }
         
-        // At least one empty-group exists
-        assert(!_list.empty());
+        // Interrupt the thread running the tasks when the generation
+        // does not match the current generation
+        if( task.generation() != _waitingQueue.generation() )
+          ThreadImpl::current()->interrupt();
+
+        // Otherwise, clear the interrupted status for the thread and
+        // give it a clean slate to start with
+        else
+          ThreadImpl::current()->isInterrupted();
+
+        return true;
+
+      }
+
+      /**
+       * Run a queued task on the calling thread, which need not be a worker.
+       *
+       * @return false if no task was queued.
+       */
+      bool runQueued() {
+
+        ExecutorTask task;
+
+        if(!poll(task))
+          return false;
+
+        if(dropped(task))
+          return true;
+
+        // Interrupt tasks from an older generation, as a worker would
+        bool interrupt = task.generation() != _waitingQueue.generation();
+        if(interrupt)
+          ThreadImpl::current()->interrupt();
+
+        run(task, 0);
+
+        // Don't leave an interrupt meant for the task to the calling thread
+        if(interrupt)
+          ThreadImpl::current()->isInterrupted();
+
+        return true;
+
+      }
+
+      //! Start collecting metrics for the calling worker
+      WorkerStats* attach() {
+
+#if defined(ZTHREAD_DISABLE_METRICS)
+        return 0;
+#else
+
+        Guard<FastMutex> g(_lock);
+
+        _stats.push_back(WorkerStats());
+        return &_stats.back();
+
+#endif
+
+      }
+
+      //! Fold the metrics of an exiting worker into those of the retired workers
+      void detach(WorkerStats* stats) {
+
+        if(!stats)
+          return;
+
+        Guard<FastMutex> g(_lock);
+
+        _retired.metrics   += stats->current(Clock::microseconds());
+        _retired.queueWait += stats->queueWait;
+        _retired.runTime   += stats->runTime;
+
+        for(StatsList::iterator i = _stats.begin(); i != _stats.end(); ++i)
+          if(&*i == stats) {
+            _stats.erase(i);
+            break;
+          }
+
+      }
+
+      /**
+       * Take a task from the queue, if one is available, without blocking.
+       *
+       * @return false if no task was queued
+       */
+      bool poll(ExecutorTask& task) {
+
+        bool found = 
+          _sharedQueue   ? _sharedQueue->tryNext(task) :
+          _stealingQueue ? _stealingQueue->tryNext(task) : _nodeQueue->tryNext(task);
+
+        return found && taken();
+
+      }
+
+      /**
+       * Take the task that has waited longest, as far as the queue can tell,
+       * without blocking.
+       *
+       * @return false if no task was queued
+       */
+      bool pollOldest(ExecutorTask& task) {
+
+        bool found = 
+          _sharedQueue   ? _sharedQueue->tryOldest(task) :
+          _stealingQueue ? _stealingQueue->tryOldest(task) : _nodeQueue->tryOldest(task);
+
+        return found && taken();
+
+      }
+
+      //! Account for a task taken from the queue
+      bool taken() {
+
+        if(_elastic)
+          AtomicOps::decrement(_queued);
+
+        drawn(1);
+        return true;
+
+      }
+
+      //! Claim room in the queue for n tasks, failing if it is full
+      bool reserve(size_t n) {
+
+        for(;;) {
+
+          size_t depth = AtomicOps::load(_depth);
+          size_t capacity = AtomicOps::load(_capacity);
+
+          // A batch larger than the capacity is let in once the queue is empty
+          if(capacity > 0 && depth > 0 && depth + n > capacity)
+            return false;
+
+          if(AtomicOps::cas(_depth, depth, depth + n))
+            return true;
+
+        }
+
+      }
+
+      //! Give back room claimed for tasks that were not queued
+      void release(size_t n) {
+        drawn(n);
+      }
+
+      //! Count tasks taken from the queue, waking threads blocked on a full queue
+      void drawn(size_t n) {
+
+        AtomicOps::fetchAndAdd(_depth, 0 - n);
+
+        if(AtomicOps::load(_blocked) > 0) {
+
+          Guard<FastMutex> g(_roomLock);
+          _room.broadcast();
+
+        }
+
+      }
+
+      /**
+       * Claim room in the queue for n tasks, applying the overflow policy 
+       * when the queue is full.
+       *
+       * @return false if the tasks should be run by the calling thread
+       *
+       * @exception Cancellation_Exception thrown if the executor was canceled
+       * @exception Overflow_Exception thrown if the tasks are rejected
+       * @exception Timeout_Exception thrown if no room was made in time
+       */
+      bool admit(size_t n) {
+
+        if(reserve(n))
+          return true;
+
+        // A canceled executor takes no more tasks, whatever the policy
+        if(_taskQueue->isCanceled())
+          throw Cancellation_Exception();
+
+        switch(_overflow) {
+
+          case PoolExecutor::CallerRuns:
+            return false;
+
+          case PoolExecutor::Reject:
+
+            AtomicOps::increment(_rejected);
+            throw Overflow_Exception();
+
+          case PoolExecutor::DiscardOldest: {
+
+            ExecutorTask oldest;
+
+            while(!reserve(n)) {
+
+              // Room is claimed by tasks about to be queued
+              if(!pollOldest(oldest)) {
+
+                Thread::yield();
+                continue;
+
+              }
+
+              AtomicOps::increment(_discarded);
+              oldest.discard();
+
+            }
+
+            return true;
+
+          }
+
+          case PoolExecutor::Block:
+          default: 
+            break;
+
+        }
+
+        unsigned long start = currentTick();
+        unsigned long timeout = _overflowTimeout;
+
+        Guard<FastMutex> g(_roomLock);
+        AtomicOps::increment(_blocked);
+
+        try {
 
-        GroupList::iterator i = --_list.end();
-        size_t n = i->id;
+          while(!reserve(n)) {
 
-        if(i == _list.end()) {
+            if(_taskQueue->isCanceled())
+              throw Cancellation_Exception();
 
-          // A group should never have been removed until
-          // the final task in that group completed
-          assert(0);
+            if(timeout == 0) {
 
-        }
+              _room.wait();
+              continue;
 
-        i->count++;
+            }
 
-        // When the active group is being incremented, insert a new active group
-        // to replace it if there were waiting threads
-        if(i == --_list.end() && !i->waiters.empty()) 
-          _list.push_back(Group(_id++));
+            unsigned long elapsed = currentTick() - start;
 
-        // At least 1 non-empty group exists
-        assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+            if(elapsed >= timeout || !_room.wait(timeout - elapsed)) {
 
-        return std::make_pair(n, _generation);
+              AtomicOps::increment(_rejected);
+              throw Timeout_Exception();
 
-      }
-      
+            }
 
-      /**
-       * Decrease the count for the group with the given id.
-       *
-       * @param n group id
-       * 
-       * @pre  At least 1 non-empty group exists
-       * @post At least 1 empty group exists
-       */
-      void decrement(size_t n) {
-       
-        Guard<FastMutex> g1(_lock);
-       
-        // At least 1 non-empty group exists
-        assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+          }
 
-        // Find the requested group
-        GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-        if(i == _list.end()) {
-          
-          // A group should never have been removed until
-          // the final task in that group completed
-          assert(0);
+        } catch(...) {
+
+          AtomicOps::decrement(_blocked);
+          throw;
 
         }
 
-        // Decrease the count for tasks in this group,
-        if(--i->count == 0 && i == _list.begin()) {
-       
-          do { 
+        AtomicOps::decrement(_blocked);
+        return true;
 
-            // When the first group completes, wake all waiters for every
-            // group, starting from the first until a group that is not 
-            // complete is reached
+      }
 
-            /*
-            // Don't remove the empty active group
-            if(i == --_list.end() && i->waiters.empty())
-              break;
-            */
-            
-            if( awaken(*i) ) {
-            
-              // If all waiters were awakened, remove the group  
-              i = _list.erase(i);
-              
-            } else {
-              
-              {
-
-                // Otherwise, unlock and yield allowing the waiter
-                // lists to be updated if other threads are busy
-                Guard<FastLock, UnlockedScope> g2(g1);
-                ThreadImpl::yield();
-              
-              }
+      void capacity(size_t n, PoolExecutor::OverflowPolicy policy, unsigned long timeout) {
 
-              i = _list.begin();
+        Guard<FastMutex> g(_roomLock);
 
-            }
-              
-          } while(i != _list.end() && i->count == 0); 
-          
-          // Ensure that an active group exists
-          if(_list.empty())
-            _list.push_back( Group(++_id) );
+        _overflow        = policy;
+        _overflowTimeout = timeout;
 
-        }
+        AtomicOps::store(_capacity, n);
+
+        // Let blocked threads see a larger capacity
+        _room.broadcast();
 
-        // At least one group exists
-        assert(!_list.empty());
-        
       }
 
       /**
+       * Drop a task, without running it, if its token was canceled or, when
+       * expired tasks are dropped, if its deadline has passed.
+       *
+       * @return true if the task was dropped
        */
-      size_t generation(bool next = false) {
-
-        Guard<FastMutex> g(_lock);
-        return next ? _generation++ : _generation;
+      bool dropped(ExecutorTask& task) {
 
-      }
-      
-    private:
-      
-      /**
-       * Awaken all the waiters remaining in the given group
-       * 
-       * @return
-       *   - true if all the waiting threads were successfully awakened.
-       *   - false if there were one or more threads that could not be awakened.
-       */
-      bool awaken(Group& grp) {
+        if(task.canceled()) {
 
-        // Go through the waiter list in the given group; 
-        for(ThreadList::iterator i = grp.waiters.begin(); i != grp.waiters.end();) {
-          
-          ThreadImpl* impl = *i;
-          Monitor& m = impl->getMonitor();
-          
-          // Try the monitor lock, if it cant be locked skip to the next waiter
-          if(m.tryAcquire()) {
-            
-            // Notify the monitor & remove from the waiter list so time isn't
-            // wasted checking it again.
-            i = grp.waiters.erase(i);
-            
-            // Try to wake the waiter, it doesn't matter if this is successful
-            // or not (only fails when the monitor is already going to stop waiting). 
-            m.notify();
-            m.release();
-            
-          } else ++i;
-          
-        }
-        
-        return grp.waiters.empty();
+          AtomicOps::increment(_dropped);
+          task.discard();
 
-      }
+          return true;
 
-    };
+        }
 
-    /**
-     * @class GroupedRunnable
-     * 
-     * Wrap a task with group and generation information. 
-     *
-     * - 'group' allows tasks to be grouped together so that lists of waiting
-     *   threads can be managed.
-     *
-     * - 'generation' allows tasks to be interrupted  
-     */
-    class GroupedRunnable : public Runnable {
+        if(!task.timed() || !_dropExpired || !task.late(currentTick()))
+          return false;
 
-      Task _task;
-      WaiterQueue& _queue;
+        AtomicOps::increment(_expired);
 
-      size_t _group;
-      size_t _generation;
+        if(_expiredHandler) {
 
-    public:
+          try {
+            _expiredHandler(task.task(), _expiredArgument);
+          } catch(...) { }
 
-      GroupedRunnable(const Task& task, WaiterQueue& queue)
-        : _task(task), _queue(queue) { 
-        
-        std::pair<size_t, size_t> pr( _queue.increment() );
-    
-        _group      = pr.first;
-        _generation = pr.second;
+        }
 
-      }
+        task.discard();
+        return true;
 
-      size_t group() const {
-        return _group;
       }
 
-      size_t generation() const {
-        return _generation;
-      }
+      /**
+       * Run a task, timing it unless metrics are disabled.
+       *
+       * @param stats metrics of the calling worker, 0 for a thread that
+       *        is only helping
+       */
+      void run(ExecutorTask& task, WorkerStats* stats) {
 
-      void run() {
+#if !defined(ZTHREAD_DISABLE_METRICS)
 
-        try {
+        unsigned long long start = Clock::microseconds();
+        unsigned long long cpu = Clock::threadTime();
 
-          _task->run();
+#endif
 
-        } catch(...) {
+        // The token was canceled after the task was drawn
+        if(!task.invoke()) {
 
-        }
+          AtomicOps::increment(_dropped);
+          task.discard();
 
-        _queue.decrement( group() );
+          return;
 
-      }
+        }
 
-    };
+        if(task.timed() && task.late(currentTick()))
+          AtomicOps::increment(_missed);
 
-    typedef CountedPtr<GroupedRunnable, size_t> ExecutorTask;
+#if !defined(ZTHREAD_DISABLE_METRICS)
 
-    /**
-     *
-     */
-    class ExecutorImpl {
-      
-      typedef MonitoredQueue<ExecutorTask, FastMutex> TaskQueue;
-      typedef std::deque<ThreadImpl*> ThreadList;
-      
-      TaskQueue   _taskQueue;
-      WaiterQueue _waitingQueue;
+        unsigned long long end = Clock::microseconds();
+        cpu = Clock::threadTime() - cpu;
 
-      ThreadList      _threads;
-      volatile size_t _size;
+        unsigned long long wait = start > task.enqueued() ? start - task.enqueued() : 0;
 
+        if(stats)
+          stats->record(wait, end - start, cpu);
 
-    public:
-      
-      ExecutorImpl() : _size(0) {}
+        else {
 
+          Guard<FastMutex> g(_helperLock);
+          _helpers.record(wait, end - start, cpu);
 
-      void registerThread() {
-        
-        Guard<TaskQueue> g(_taskQueue);
+        }
 
-        ThreadImpl* impl = ThreadImpl::current();
-        _threads.push_back(impl);
+#endif
 
-        // current cancel if too many threads are being created
-        if(_threads.size() > _size) 
-          impl->cancel();
+        // Counted before waiting threads are released, so that a snapshot 
+        // taken after wait() includes the task
+        task.finish();
 
       }
 
-      void unregisterThread() {
-
-        Guard<TaskQueue> g(_taskQueue);
-        std::remove(_threads.begin(), _threads.end(), ThreadImpl::current());
-
-      }
+      ExecutorMetrics metrics() {
 
-      void execute(const Task& task) {
+        ExecutorMetrics m;
 
-        // Wrap the task with a grouped task
-        GroupedRunnable* runnable = new GroupedRunnable(task, _waitingQueue);
- 
-        try {
-          
-          _taskQueue.add( ExecutorTask(runnable) );
+        Guard<FastMutex> g(_lock);
 
-        } catch(...) {
+        m.dropped = AtomicOps::load(_dropped);
+        m.expired = AtomicOps::load(_expired);
+        m.missed  = AtomicOps::load(_missed);
 
-          // Incase the queue is canceled between the time the WaiterQueue is 
-          // updated and the task is added to the TaskQueue
-          _waitingQueue.decrement( runnable->group() );
-          throw;
+        m.rejected  = AtomicOps::load(_rejected);
+        m.discarded = AtomicOps::load(_discarded);
 
-        }
+        m.depth = AtomicOps::load(_depth);
 
-      }
+#if defined(ZTHREAD_DISABLE_METRICS)
 
-      void interrupt() {
+        m.workers.resize(_threads.size());
 
-        // Bump the generation number
-        _waitingQueue.generation(true);
+#else
 
-        Guard<TaskQueue> g(_taskQueue);
-        
-        // Interrupt all threads currently running, thier tasks would be
-        // from an older generation
-        for(ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
-          (*i)->interrupt();
-       
-      }
+        unsigned long long now = Clock::microseconds();
 
-      //! Adjust the number of desired workers and return the number of Threads needed
-      size_t workers(size_t n) {
-        
-        Guard<TaskQueue> g(_taskQueue);
+        m.total     = _retired.metrics;
+        m.queueWait = _retired.queueWait;
+        m.runTime   = _retired.runTime;
 
-        size_t m = (_size < n) ? (n - _size) : 0;
-        _size = n;
-        
-        return m;
+        for(StatsList::const_iterator i = _stats.begin(); i != _stats.end(); ++i) {
 
-      }
-      
-      size_t workers() {
-        
-        Guard<TaskQueue> g(_taskQueue);
-        return _size;
-        
-      }
-      
-      ExecutorTask next() {
-        
-        ExecutorTask task;
-        
-        // Draw the task from the queue
-        for(;;) {
+          m.workers.push_back(i->current(now));
 
-          try { 
+          m.total     += m.workers.back();
+          m.queueWait += i->queueWait;
+          m.runTime   += i->runTime;
 
-            task = _taskQueue.next();
-            break;
+        }
 
-          } catch(Interrupted_Exception&) {
+        {
 
-            // Ignore interruption here, it can only come from
-            // another thread interrupt()ing the executor. The
-            // thread was interrupted in the hopes it was busy 
-            // with a task
+          Guard<FastMutex> h(_helperLock);
 
-          }
+          // Helpers are not idle between tasks as far as this executor knows
+          m.total     += _helpers.metrics;
+          m.queueWait += _helpers.queueWait;
+          m.runTime   += _helpers.runTime;
 
         }
-        
-        // Interrupt the thread running the tasks when the generation
-        // does not match the current generation
-        if( task->generation() != _waitingQueue.generation() )
-          ThreadImpl::current()->interrupt();
 
-        // Otherwise, clear the interrupted status for the thread and
-        // give it a clean slate to start with
-        else
-          ThreadImpl::current()->isInterrupted();
+        m.submitted = AtomicOps::load(_accepted);
+        m.completed = m.runTime.samples();
+
+#endif
 
-        return task;
+        return m;
 
       }
 
       bool isCanceled() {
-        return _taskQueue.isCanceled();
+        return _taskQueue->isCanceled();
       }
 
       void cancel() {
-        _taskQueue.cancel();
+
+        _taskQueue->cancel();
+
+        // Threads blocked on a full queue give up
+        if(AtomicOps::load(_blocked) > 0) {
+
+          Guard<FastMutex> g(_roomLock);
+          _room.broadcast();
+
+        }
+
       }
 
       bool wait(unsigned long timeout) {
@@ -508,6 +1688,8 @@ namespace ZThread {
 
     };
 
+    void spawn(const CountedPtr< ExecutorImpl >& impl);
+
     //! Executor job
     class Worker : public Runnable {
 
@@ -519,26 +1701,68 @@ namespace ZThread {
       Worker(const CountedPtr< ExecutorImpl >& impl) 
         : _impl(impl) { }
    
-      //! Run until Thread or Queue are canceled
+      //! Run until Thread or Queue are canceled, or until the worker retires
       void run() { 
         
-        _impl->registerThread();
+        size_t index = _impl->registerThread();
+        size_t version = _impl->place(index);
+
+        WorkerStats* stats = _impl->attach();
         
-        // Run until the Queue is canceled
-        while(!Thread::canceled()) {
+        try {
+
+          // Run until the Queue is canceled
+          while(!Thread::canceled()) {
+
+            if(_impl->misplaced(version))
+              version = _impl->place(index);
           
-          // Draw tasks from the queue
-          ExecutorTask task( _impl->next() );
-          task->run();
+            // Draw tasks from the queue
+            ExecutorTask task;
+            if(!_impl->next(task))
+              break;
+
+            // Add a worker when the task waited too long for this one
+            if(_impl->backlogged(&task) && _impl->grow())
+              spawn(_impl);
+
+            _impl->run(task, stats);
+
+            if(_impl->completed())
+              spawn(_impl);
                     
-        } 
+          } 
+
+        } catch(Cancellation_Exception&) {
+
+          // The queue was canceled and has been drained
+
+        }
         
+        _impl->detach(stats);
         _impl->unregisterThread();
    
       }
       
     }; /* Worker */
 
+    //! Start a worker reserved with ExecutorImpl::grow()
+    void spawn(const CountedPtr< ExecutorImpl >& impl) {
+
+      CountedPtr< ExecutorImpl > pool(impl);
+
+      try {
+
+        Thread t(new Worker(pool));
+
+      } catch(Synchronization_Exception&) {
+
+        pool->abandon();
+
+      }
+
+    }
+
 
     //! Helper
     class Shutdown : public Runnable {
@@ -559,7 +1783,19 @@ namespace ZThread {
   }
 
   PoolExecutor::PoolExecutor(size_t n)
-    : _impl( new ExecutorImpl() ), _shutdown( new Shutdown(_impl) ) {
+    : _work( new WorkSignal ), _impl( new ExecutorImpl(SharedQueue, _work) ), 
+      _shutdown( new Shutdown(_impl) ) {
+   
+    size(n);
+    
+    // Request cancelation when main() exits
+    ThreadQueue::instance()->insertShutdownTask(_shutdown);
+
+  }
+
+  PoolExecutor::PoolExecutor(size_t n, Scheduling scheduling)
+    : _work( new WorkSignal ), _impl( new ExecutorImpl(scheduling, _work) ), 
+      _shutdown( new Shutdown(_impl) ) {
    
     size(n);
     
@@ -568,6 +1804,21 @@ namespace ZThread {
 
   }
 
+  PoolExecutor::PoolExecutor(size_t minimum, size_t maximum, unsigned long keepAlive, Scheduling scheduling)
+    : _work( new WorkSignal ), _impl( new ExecutorImpl(scheduling, _work) ), 
+      _shutdown( new Shutdown(_impl) ) {
+
+    if(minimum < 1 || maximum < minimum)
+      throw InvalidOp_Exception();
+
+    _impl->elastic(minimum, maximum, keepAlive);
+    size(minimum);
+    
+    // Request cancelation when main() exits
+    ThreadQueue::instance()->insertShutdownTask(_shutdown);
+
+  }
+
   PoolExecutor::~PoolExecutor() { 
 
     try {
@@ -608,6 +1859,109 @@ namespace ZThread {
     // Cancelation_Exception if the Executor has been canceled
     _impl->execute(task); 
 
+    if(_impl->backlogged() && _impl->grow())
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::execute(const Task& task, Priority priority) {
+
+    _impl->execute(task, priority); 
+
+    if(_impl->backlogged() && _impl->grow())
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::execute(const Task& task, const CancellationToken& token, Priority priority) {
+
+    _impl->execute(task, token._impl, priority); 
+
+    if(_impl->backlogged() && _impl->grow())
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::execute(const Task& task, const Time& deadline) {
+
+    _impl->execute(task, deadline.seconds() * 1000 + deadline.milliseconds()); 
+
+    if(_impl->backlogged() && _impl->grow())
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::capacity(size_t n, OverflowPolicy policy, unsigned long timeout) {
+    _impl->capacity(n, policy, timeout);
+  }
+
+  void PoolExecutor::expiry(ExpiryPolicy policy, void (*handler)(const Task& task, void* argument), void* argument) {
+    _impl->expiry(policy, handler, argument);
+  }
+
+  bool PoolExecutor::runQueued() {
+    return _impl->runQueued();
+  }
+
+  ExecutorMetrics PoolExecutor::metrics() {
+    return _impl->metrics();
+  }
+
+  void PoolExecutor::priorities(PriorityPolicy policy, size_t aging, size_t burst) {
+    _impl->priorities(policy, aging, burst);
+  }
+
+  void PoolExecutor::weights(size_t low, size_t medium, size_t high) {
+    _impl->weights(low, medium, high);
+  }
+
+  void PoolExecutor::execute(void (*function)(void*), void* argument) {
+
+    _impl->execute(function, argument);
+
+    if(_impl->backlogged() && _impl->grow())
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::executeBatch(const Task* tasks, size_t n) {
+
+    _impl->execute(tasks, n);
+
+    // Add at most one worker per task 
+    for(; n > 0 && _impl->backlogged() && _impl->grow(); --n)
+      spawn(_impl);
+
+  }
+
+  void PoolExecutor::growth(size_t backlog, unsigned long age) {
+    _impl->growth(backlog, age);
+  }
+
+  void PoolExecutor::tuning(bool enabled) {
+    _impl->tuning(enabled);
+  }
+
+  void PoolExecutor::spinning(size_t spins, size_t yields, size_t spinners) {
+    _impl->spinning(spins, yields, spinners);
+  }
+
+  void PoolExecutor::placement(Placement placement) {
+
+    if(placement == CpuSet)
+      throw InvalidOp_Exception();
+
+    _impl->placement(placement, std::vector<size_t>());
+
+  }
+
+  void PoolExecutor::placement(const std::vector<size_t>& cpus) {
+
+    if(cpus.empty())
+      throw InvalidOp_Exception();
+
+    _impl->placement(CpuSet, cpus);
+
   }
 
   void PoolExecutor::cancel() {
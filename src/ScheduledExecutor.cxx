@@ -0,0 +1,849 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ThreadImpl.h"
+#include "zthread/ScheduledExecutor.h"
+#include "zthread/PoolExecutor.h"
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/Time.h"
+#include "Clock.h"
+#include "ThreadQueue.h"
+#include "AtomicOps.h"
+
+namespace ZThread {
+
+  namespace {
+
+    //! Signed distance between two ticks, correct across wrap-around
+    inline long distance(unsigned long from, unsigned long to) {
+      return (long)(to - from);
+    }
+
+    /**
+     * @class TimerLink
+     *
+     * Links for the intrusive, circular lists that make up the slots of 
+     * the timer wheel.
+     */
+    class TimerLink {
+    public:
+
+      TimerLink* next;
+      TimerLink* prev;
+
+      TimerLink() : next(this), prev(this) { }
+
+      bool empty() const {
+        return next == this;
+      }
+
+      void append(TimerLink* link) {
+
+        link->prev = prev;
+        link->next = this;
+
+        prev->next = link;
+        prev = link;
+
+      }
+
+      void unlink() {
+
+        prev->next = next;
+        next->prev = prev;
+
+        next = prev = this;
+
+      }
+
+      //! Move every link in this list to the end of another list
+      void spliceTo(TimerLink& list) {
+
+        if(empty())
+          return;
+
+        next->prev = list.prev;
+        prev->next = &list;
+
+        list.prev->next = next;
+        list.prev = prev;
+
+        next = prev = this;
+
+      }
+
+    };
+
+    /**
+     * @class TimerEntry
+     *
+     * A scheduled task. An entry is referenced by its ScheduledTask handles, 
+     * by the timer wheel while it is SCHEDULED, and by the task handed to
+     * the PoolExecutor while it is DISPATCHED or RUNNING.
+     */
+    class TimerEntry : public TimerLink {
+    public:
+
+      typedef enum { ONCE, FIXED_RATE, FIXED_DELAY } MODE;
+
+      typedef enum { SCHEDULED, DISPATCHED, RUNNING, DONE, CANCELED } STATE;
+
+      Task task;
+      MODE mode;
+
+      unsigned long expires;
+      unsigned long period;
+
+      //! Level of the wheel holding this entry
+      size_t level;
+
+      volatile long state;
+      volatile long count;
+
+      TimerEntry(const Task& t, MODE m, unsigned long e, unsigned long p)
+        : task(t), mode(m), expires(e), period(p), level(0), state(SCHEDULED), count(1) { }
+
+      void addReference() {
+        AtomicOps::increment(count);
+      }
+
+      void delReference() {
+
+        if(AtomicOps::decrement(count) == 0)
+          delete this;
+
+      }
+
+      bool transition(STATE from, STATE to) {
+        return AtomicOps::cas(state, (long)from, (long)to);
+      }
+
+    };
+
+    /**
+     * @class TimerWheel
+     *
+     * A hierarchical timer wheel. The first level has a slot for each of the 
+     * next 256 ticks; each further level has 64 slots, each covering 64 times
+     * the span of a slot on the level below. Entries are inserted and removed 
+     * in constant time; a slot on a higher level is cascaded into the lower 
+     * levels as the wheel turns past it.
+     *
+     * The wheel is not synchronized.
+     */
+    class TimerWheel {
+
+      enum { 
+        NEAR_BITS = 8, 
+        NEAR_SIZE = 1 << NEAR_BITS, 
+        NEAR_MASK = NEAR_SIZE - 1,
+        FAR_BITS = 6, 
+        FAR_SIZE = 1 << FAR_BITS, 
+        FAR_MASK = FAR_SIZE - 1,
+        FAR_LEVELS = 4,
+        LEVELS = FAR_LEVELS + 1
+      };
+
+      //! Span of the wheel; entries beyond it are re-examined as the top level turns
+      static const unsigned long MAX_TICKS = 0xffffffffUL;
+
+      TimerLink _near[NEAR_SIZE];
+      TimerLink _far[FAR_LEVELS][FAR_SIZE];
+
+      //! Number of entries on each level
+      size_t _counts[LEVELS];
+
+      //! Next tick to be processed
+      unsigned long _current;
+
+      //! Number of low bits of a tick below the slot index of a level
+      static unsigned long shift(size_t level) {
+        return level == 0 ? 0 : NEAR_BITS + (level - 1) * FAR_BITS;
+      }
+
+      //! First tick at or after the current tick where a level turns to its next slot
+      unsigned long boundary(size_t level) const {
+
+        unsigned long mask = (1UL << shift(level)) - 1;
+        return (_current + mask) & ~mask;
+
+      }
+
+      //! Re-insert every entry in a slot
+      void cascade(TimerLink& slot, size_t level) {
+
+        TimerLink list;
+        slot.spliceTo(list);
+
+        while(!list.empty()) {
+
+          TimerEntry* e = static_cast<TimerEntry*>(list.next);
+          e->unlink();
+
+          _counts[level]--;
+          insert(e);
+
+        }
+
+      }
+
+    public:
+
+      TimerWheel(unsigned long now) : _current(now) {
+
+        for(size_t n = 0; n < LEVELS; ++n)
+          _counts[n] = 0;
+
+      }
+
+      size_t size() const {
+
+        size_t n = 0;
+        for(size_t i = 0; i < LEVELS; ++i)
+          n += _counts[i];
+
+        return n;
+
+      }
+
+      void insert(TimerEntry* e) {
+
+        unsigned long expires = e->expires;
+        if(distance(_current, expires) < 0)
+          expires = _current;
+
+        unsigned long ticks = expires - _current;
+        if(ticks > MAX_TICKS) {
+
+          ticks = MAX_TICKS;
+          expires = _current + ticks;
+
+        }
+
+        if(ticks < (unsigned long)NEAR_SIZE) {
+
+          e->level = 0;
+          _near[expires & NEAR_MASK].append(e);
+
+        } else {
+
+          size_t level = 1;
+          while(level < FAR_LEVELS && ticks >= (1UL << shift(level + 1)))
+            ++level;
+
+          e->level = level;
+          _far[level - 1][(expires >> shift(level)) & FAR_MASK].append(e);
+
+        }
+
+        _counts[e->level]++;
+
+      }
+
+      void remove(TimerEntry* e) {
+
+        e->unlink();
+        _counts[e->level]--;
+
+      }
+
+      /**
+       * Turn the wheel up to and including the given tick.
+       *
+       * @param now current tick
+       * @param due list receiving the entries that have become due
+       */
+      void advance(unsigned long now, TimerLink& due) {
+
+        while(distance(_current, now) >= 0) {
+
+          size_t level = 0;
+          while(level < LEVELS && _counts[level] == 0)
+            ++level;
+
+          if(level == LEVELS) {
+
+            _current = now + 1;
+            return;
+
+          }
+
+          // Nothing can happen before the lowest occupied level next cascades
+          if(level > 0) {
+
+            unsigned long next = boundary(level);
+            if(distance(next, now) < 0) {
+
+              _current = now + 1;
+              return;
+
+            }
+
+            _current = next;
+
+          }
+
+          if((_current & NEAR_MASK) == 0) {
+
+            for(size_t n = 1; n < LEVELS; ++n) {
+
+              size_t index = (_current >> shift(n)) & FAR_MASK;
+              cascade(_far[n - 1][index], n);
+
+              if(index != 0)
+                break;
+
+            }
+
+          }
+
+          TimerLink& slot = _near[_current & NEAR_MASK];
+          while(!slot.empty()) {
+
+            TimerEntry* e = static_cast<TimerEntry*>(slot.next);
+            remove(e);
+
+            // Entries beyond the span of the wheel may not be due yet
+            if(distance(_current, e->expires) > 0)
+              insert(e);
+            else
+              due.append(e);
+
+          }
+
+          ++_current;
+
+        }
+
+      }
+
+      /**
+       * Find the next tick at which the wheel has work to do.
+       *
+       * @param when receives the tick
+       * @return false if the wheel is empty
+       */
+      bool next(unsigned long& when) const {
+
+        bool found = false;
+
+        // A cascade can bring entries down before the first one on the near level
+        for(size_t level = 1; level < LEVELS && !found; ++level) 
+          if(_counts[level] > 0) {
+
+            when = boundary(level);
+            found = true;
+
+          }
+
+        if(_counts[0] > 0) {
+
+          for(unsigned long n = 0; n < NEAR_SIZE; ++n) 
+            if(!_near[(_current + n) & NEAR_MASK].empty()) {
+
+              if(!found || distance(_current + n, when) > 0)
+                when = _current + n;
+
+              return true;
+
+            }
+
+        }
+
+        return found;
+
+      }
+
+      //! Remove every entry
+      void clear(TimerLink& list) {
+
+        for(size_t n = 0; n < NEAR_SIZE; ++n)
+          _near[n].spliceTo(list);
+
+        for(size_t level = 0; level < FAR_LEVELS; ++level)
+          for(size_t n = 0; n < FAR_SIZE; ++n)
+            _far[level][n].spliceTo(list);
+
+        for(size_t n = 0; n < LEVELS; ++n)
+          _counts[n] = 0;
+
+      }
+
+    };
+
+    /**
+     * @class SchedulerImpl
+     *
+     * The timer wheel, the timer thread and the PoolExecutor that runs 
+     * tasks once they are due.
+     */
+    class SchedulerImpl {
+
+      //! Serialize access to the wheel
+      FastMutex _lock;
+
+      //! Wakes the timer thread
+      Condition _wakeup;
+
+      TimerWheel _wheel;
+
+      //! Executor running the tasks that are due
+      PoolExecutor _executor;
+
+      //! Tick the timer thread will wake up at, when _parked
+      unsigned long _wakeAt;
+
+      //! Set while the timer thread is waiting for _wakeAt
+      bool _parked;
+
+      //! Set while the timer thread is waiting without a timeout
+      bool _idle;
+
+      bool _canceled;
+
+      //! Hand entries that are due to the executor
+      void dispatch(TimerLink& due, const CountedPtr< SchedulerImpl >& self);
+
+      //! Release the entries in a list that will never be run
+      static void discard(TimerLink& list) {
+
+        while(!list.empty()) {
+
+          TimerEntry* e = static_cast<TimerEntry*>(list.next);
+          e->unlink();
+
+          e->transition(TimerEntry::SCHEDULED, TimerEntry::CANCELED);
+          e->transition(TimerEntry::DISPATCHED, TimerEntry::CANCELED);
+          e->delReference();
+
+        }
+
+      }
+
+      //! Add an entry to the wheel, waking the timer thread if it is due earlier
+      void insert(TimerEntry* e) {
+
+        _wheel.insert(e);
+
+        if(_idle || (_parked && distance(e->expires, _wakeAt) > 0)) {
+
+          _idle = _parked = false;
+          _wakeup.signal();
+
+        }
+
+      }
+
+    public:
+
+      SchedulerImpl(size_t n) 
+        : _wakeup(_lock), _wheel(currentTick()), _executor(n), 
+          _wakeAt(0), _parked(false), _idle(false), _canceled(false) { }
+
+      PoolExecutor& executor() {
+        return _executor;
+      }
+
+      //! Schedule a new entry, returning it with a reference for the caller
+      TimerEntry* schedule(const Task& task, TimerEntry::MODE mode, 
+                           unsigned long delay, unsigned long period) {
+
+        TimerEntry* e = new TimerEntry(task, mode, currentTick() + delay, period);
+
+        Guard<FastMutex> g(_lock);
+
+        if(_canceled) {
+
+          delete e;
+          throw Cancellation_Exception();
+
+        }
+
+        // One reference for the wheel, one for the caller
+        e->addReference();
+        insert(e);
+
+        return e;
+
+      }
+
+      //! Cancel an entry
+      void cancel(TimerEntry* e) {
+
+        {
+
+          Guard<FastMutex> g(_lock);
+
+          if(e->transition(TimerEntry::SCHEDULED, TimerEntry::CANCELED)) {
+
+            _wheel.remove(e);
+            e->delReference();
+
+            return;
+
+          }
+
+        }
+
+        if(e->transition(TimerEntry::DISPATCHED, TimerEntry::CANCELED))
+          return;
+
+        // A periodic entry that is running is not rescheduled
+        if(e->mode != TimerEntry::ONCE)
+          e->transition(TimerEntry::RUNNING, TimerEntry::CANCELED);
+
+      }
+
+      //! Run a dispatched entry
+      void run(TimerEntry* e) {
+
+        if(!e->transition(TimerEntry::DISPATCHED, TimerEntry::RUNNING))
+          return;
+
+        bool failed = false;
+
+        try {
+          e->task->run();
+        } catch(...) {
+          failed = true;
+        }
+
+        if(e->mode == TimerEntry::ONCE || failed) {
+
+          e->transition(TimerEntry::RUNNING, TimerEntry::DONE);
+          return;
+
+        }
+
+        Guard<FastMutex> g(_lock);
+
+        if(_canceled) {
+
+          e->transition(TimerEntry::RUNNING, TimerEntry::CANCELED);
+          return;
+
+        }
+
+        if(!e->transition(TimerEntry::RUNNING, TimerEntry::SCHEDULED))
+          return;
+
+        if(e->mode == TimerEntry::FIXED_RATE)
+          e->expires += e->period;
+        else
+          e->expires = currentTick() + e->period;
+
+        e->addReference();
+        insert(e);
+
+      }
+
+      //! Run the timer thread until canceled
+      void runTimer(const CountedPtr< SchedulerImpl >& self) {
+
+        Guard<FastMutex> g(_lock);
+
+        while(!_canceled) {
+
+          unsigned long now = currentTick();
+
+          TimerLink due;
+          _wheel.advance(now, due);
+
+          if(!due.empty()) {
+
+            Guard<FastMutex, UnlockedScope> g2(g);
+            dispatch(due, self);
+
+            continue;
+
+          }
+
+          try {
+
+            unsigned long when;
+            if(!_wheel.next(when)) {
+
+              _idle = true;
+              _wakeup.wait();
+
+            } else if(distance(now, when) > 0) {
+
+              _wakeAt = when;
+              _parked = true;
+
+              _wakeup.wait(distance(now, when));
+
+            }
+
+          } catch(Interrupted_Exception&) { }
+
+          _idle = _parked = false;
+
+        }
+
+      }
+
+      void cancel() {
+
+        TimerLink list;
+
+        {
+
+          Guard<FastMutex> g(_lock);
+
+          if(_canceled)
+            return;
+
+          _canceled = true;
+          _wheel.clear(list);
+
+          _wakeup.signal();
+
+        }
+
+        discard(list);
+        _executor.cancel();
+
+      }
+
+      bool isCanceled() {
+
+        Guard<FastMutex> g(_lock);
+        return _canceled;
+
+      }
+
+    };
+
+    /**
+     * @class TimerTask
+     *
+     * Runs a dispatched entry, holding the reference the wheel gave up.
+     */
+    class TimerTask : public Runnable {
+
+      CountedPtr< SchedulerImpl > _impl;
+      TimerEntry* _entry;
+
+    public:
+
+      TimerTask(const CountedPtr< SchedulerImpl >& impl, TimerEntry* entry)
+        : _impl(impl), _entry(entry) { }
+
+      virtual ~TimerTask() {
+        _entry->delReference();
+      }
+
+      void run() {
+        _impl->run(_entry);
+      }
+
+    };
+
+    void SchedulerImpl::dispatch(TimerLink& due, const CountedPtr< SchedulerImpl >& self) {
+
+      while(!due.empty()) {
+
+        TimerEntry* e = static_cast<TimerEntry*>(due.next);
+        e->unlink();
+
+        if(!e->transition(TimerEntry::SCHEDULED, TimerEntry::DISPATCHED)) {
+
+          e->delReference();
+          continue;
+
+        }
+
+        // The reference held by the wheel is released with the TimerTask
+        Task task(new TimerTask(self, e));
+
+        try {
+
+          _executor.execute(task);
+
+        } catch(Synchronization_Exception&) {
+
+          e->transition(TimerEntry::DISPATCHED, TimerEntry::CANCELED);
+          discard(due);
+
+        }
+
+      }
+
+    }
+
+    /**
+     * @class TimerThread
+     *
+     * Turns the timer wheel.
+     */
+    class TimerThread : public Runnable {
+
+      CountedPtr< SchedulerImpl > _impl;
+
+    public:
+
+      TimerThread(const CountedPtr< SchedulerImpl >& impl) 
+        : _impl(impl) { }
+
+      void run() {
+        _impl->runTimer(_impl);
+      }
+
+    };
+
+    //! Helper
+    class Shutdown : public Runnable {
+
+      CountedPtr< SchedulerImpl > _impl;
+
+    public:
+
+      Shutdown(const CountedPtr< SchedulerImpl >& impl) 
+        : _impl(impl) { }
+      
+      void run() {        
+        _impl->cancel();
+      }
+
+    };
+
+  }
+
+  ScheduledTask::ScheduledTask(const CountedPtr< SchedulerImpl >& impl, TimerEntry* entry)
+    : _impl(impl), _entry(entry) { }
+
+  ScheduledTask::ScheduledTask(const ScheduledTask& task) 
+    : _impl(task._impl), _entry(task._entry) {
+
+    _entry->addReference();
+
+  }
+
+  ScheduledTask::~ScheduledTask() {
+    _entry->delReference();
+  }
+
+  const ScheduledTask& ScheduledTask::operator=(const ScheduledTask& task) {
+
+    task._entry->addReference();
+    _entry->delReference();
+
+    _impl = task._impl;
+    _entry = task._entry;
+
+    return *this;
+
+  }
+
+  void ScheduledTask::cancel() {
+    _impl->cancel(_entry);
+  }
+
+  bool ScheduledTask::isCanceled() {
+    return AtomicOps::load(_entry->state) == TimerEntry::CANCELED;
+  }
+
+  bool ScheduledTask::isDone() {
+
+    long state = AtomicOps::load(_entry->state);
+    return state == TimerEntry::DONE || state == TimerEntry::CANCELED;
+
+  }
+
+  ScheduledExecutor::ScheduledExecutor(size_t n)
+    : _impl( new SchedulerImpl(n) ), _shutdown( new Shutdown(_impl) ) {
+
+    Thread t(new TimerThread(_impl));
+
+    // Request cancelation when main() exits
+    ThreadQueue::instance()->insertShutdownTask(_shutdown);
+
+  }
+
+  ScheduledExecutor::~ScheduledExecutor() {
+
+    try {
+
+      if(ThreadQueue::instance()->removeShutdownTask(_shutdown)) 
+        _shutdown->run();
+
+    } catch(...) { }
+
+  }
+
+  ScheduledTask ScheduledExecutor::schedule(const Task& task, unsigned long delay) {
+    return ScheduledTask(_impl, _impl->schedule(task, TimerEntry::ONCE, delay, 0));
+  }
+
+  ScheduledTask ScheduledExecutor::scheduleAtFixedRate(const Task& task, unsigned long initialDelay,
+                                                       unsigned long period) {
+
+    if(period == 0)
+      throw InvalidOp_Exception();
+
+    return ScheduledTask(_impl, _impl->schedule(task, TimerEntry::FIXED_RATE, initialDelay, period));
+
+  }
+
+  ScheduledTask ScheduledExecutor::scheduleWithFixedDelay(const Task& task, unsigned long initialDelay,
+                                                          unsigned long delay) {
+
+    if(delay == 0)
+      throw InvalidOp_Exception();
+
+    return ScheduledTask(_impl, _impl->schedule(task, TimerEntry::FIXED_DELAY, initialDelay, delay));
+
+  }
+
+  void ScheduledExecutor::interrupt() {
+    _impl->executor().interrupt();
+  }
+
+  void ScheduledExecutor::execute(const Task& task) {
+
+    if(_impl->isCanceled())
+      throw Cancellation_Exception();
+
+    _impl->executor().execute(task);
+
+  }
+
+  void ScheduledExecutor::cancel() {
+    _impl->cancel();
+  }
+
+  bool ScheduledExecutor::isCanceled() {
+    return _impl->isCanceled();
+  }
+
+  void ScheduledExecutor::wait() {
+    _impl->executor().wait();
+  }
+
+  bool ScheduledExecutor::wait(unsigned long timeout) {
+    return _impl->executor().wait(timeout);
+  }
+
+} // namespace ZThread
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "ThreadImpl.h"
+#include "zthread/SerialExecutor.h"
+#include "zthread/Guard.h"
+
+#include "AtomicOps.h"
+#include "FastLock.h"
+#include "WaiterQueue.h"
+
+#include <utility>
+
+namespace ZThread {
+
+  namespace {
+
+    typedef std::pair<size_t, size_t> Ticket;
+
+    //! Number of tasks a SerialExecutor runs before it resubmits itself
+    const size_t BATCH = 64;
+
+    //! Inbox entry
+    struct Message {
+
+      CountedPtr<Runnable, AtomicCount> task;
+      Ticket ticket;
+
+      Message* volatile next;
+
+      Message() : next(0) { }
+
+      Message(const Task& t, const Ticket& tk) : task(t), ticket(tk), next(0) { }
+
+    };
+
+    /**
+     * @class Inbox
+     *
+     * Unbounded multiple producer, single consumer queue. Producers exchange 
+     * the head and then link the previous head to the new message; the consumer
+     * follows the links from a stub message it owns. A message whose link has
+     * not been set yet is briefly invisible to the consumer.
+     */
+    class Inbox {
+
+      //! Most recently added message
+      Message* volatile _head;
+
+      //! Last message taken, owned by the consumer
+      Message* _tail;
+
+    public:
+
+      Inbox() : _head(new Message), _tail(_head) { }
+
+      ~Inbox() {
+
+        Message m;
+        while(pop(m)) ;
+
+        delete _tail;
+
+      }
+
+      void push(Message* m) {
+
+        Message* prev = AtomicOps::exchange(_head, m);
+        AtomicOps::store(prev->next, m);
+
+      }
+
+      //! Take the oldest message, only called by the consumer
+      bool pop(Message& m) {
+
+        Message* next = AtomicOps::load(_tail->next);
+        if(next == 0)
+          return false;
+
+        m.task   = next->task;
+        m.ticket = next->ticket;
+
+        // The taken message becomes the new stub
+        next->task = CountedPtr<Runnable, AtomicCount>();
+
+        delete _tail;
+        _tail = next;
+
+        return true;
+
+      }
+
+    };
+
+    class SerialImpl {
+
+      Executor& _executor;
+
+      Inbox _inbox;
+
+      //! Tasks submitted and not yet taken; the strand is posted while non-zero
+      volatile size_t _pending;
+
+      volatile bool _canceled;
+
+      WaiterQueue _queue;
+
+      //! Serialize interrupt() with the thread running a task
+      FastLock _lock;
+
+      //! Thread running a task, if any
+      ThreadImpl* _runner;
+
+    public:
+
+      SerialImpl(Executor& executor) 
+        : _executor(executor), _pending(0), _canceled(false), _runner(0) { }
+
+      WaiterQueue& getWaiterQueue() { 
+        return _queue;
+      }
+
+      /**
+       * Queue a task.
+       *
+       * @return true if the inbox was empty, and the strand should be posted
+       */
+      bool push(const Task& task) {
+
+        if(AtomicOps::load(_canceled))
+          throw Cancellation_Exception();
+
+        Ticket ticket( _queue.increment() );
+        _inbox.push(new Message(task, ticket));
+
+        return AtomicOps::fetchAndAdd(_pending, 1) == 0;
+
+      }
+
+      /**
+       * Run queued tasks, in order.
+       *
+       * @return true if tasks remain, and the strand should be posted again
+       */
+      bool drain() {
+
+        for(size_t n = 0; n < BATCH; ++n) {
+
+          Message m;
+
+          // A producer may have claimed its place without linking it yet
+          while(!_inbox.pop(m))
+            AtomicOps::pause();
+
+          run(m);
+
+          if(AtomicOps::decrement(_pending) == 0)
+            return false;
+
+        }
+
+        return true;
+
+      }
+
+      //! Give up on queued tasks, after the underlying Executor refused the strand
+      void discard() {
+
+        AtomicOps::exchange(_canceled, true);
+
+        do {
+
+          Message m;
+
+          while(!_inbox.pop(m))
+            AtomicOps::pause();
+
+          _queue.decrement(m.ticket.first);
+
+        } while(AtomicOps::decrement(_pending) > 0);
+
+      }
+
+      void interrupt() {
+
+        // Bump the generation, tasks submitted so far are interrupted
+        _queue.generation(true);
+
+        Guard<FastLock> g(_lock);
+
+        if(_runner)
+          _runner->interrupt();
+
+      }
+
+      void cancel() {
+        AtomicOps::exchange(_canceled, true);
+      }
+
+      bool isCanceled() {
+        return AtomicOps::load(_canceled);
+      }
+
+      Executor& executor() {
+        return _executor;
+      }
+
+    private:
+
+      void run(Message& m) {
+
+        ThreadImpl* self = ThreadImpl::current();
+
+        {
+
+          Guard<FastLock> g(_lock);
+          _runner = self;
+
+        }
+
+        // Interrupt tasks from an older generation, otherwise give the
+        // task a clean slate to start with
+        if(m.ticket.second != _queue.generation())
+          self->interrupt();
+        else
+          self->isInterrupted();
+
+        try {
+          m.task->run();
+        } catch(...) {
+          /* consume the exceptions the work propogates */
+        }
+
+        {
+
+          Guard<FastLock> g(_lock);
+          _runner = 0;
+
+        }
+
+        _queue.decrement(m.ticket.first);
+
+      }
+
+    };
+
+    //! Submitted to the underlying Executor to run the queued tasks
+    class Strand : public Runnable {
+
+      CountedPtr<SerialImpl> _impl;
+
+    public:
+
+      Strand(const CountedPtr<SerialImpl>& impl) : _impl(impl) { }
+
+      //! Submit a Strand to the underlying Executor
+      static void post(const CountedPtr<SerialImpl>& impl) {
+
+        CountedPtr<SerialImpl> serial(impl);
+
+        try {
+
+          serial->executor().execute(new Strand(serial));
+
+        } catch(...) {
+
+          serial->discard();
+          throw Cancellation_Exception();
+
+        }
+
+      }
+
+      void run() {
+
+        if(_impl->drain())
+          post(_impl);
+
+      }
+
+    };
+
+  }
+
+  SerialExecutor::SerialExecutor(Executor& executor) 
+    : _impl(new SerialImpl(executor)) {}
+
+  SerialExecutor::~SerialExecutor() {
+    _impl->cancel();
+  }
+  
+  void SerialExecutor::execute(const Task& task) {
+
+    // Only the task that finds the inbox empty posts the strand
+    if(_impl->push(task))
+      Strand::post(_impl);
+
+  }  
+
+  void SerialExecutor::interrupt() {
+    _impl->interrupt();
+  }
+
+  void SerialExecutor::cancel() {
+    _impl->cancel();    
+  }
+  
+  bool SerialExecutor::isCanceled() {
+    return _impl->isCanceled();
+  }
+ 
+  void SerialExecutor::wait() {
+    _impl->getWaiterQueue().wait(0);
+  }
+
+  bool SerialExecutor::wait(unsigned long timeout) { 
+    return _impl->getWaiterQueue().wait(timeout == 0 ? 1 : timeout);
+  }
+
+}
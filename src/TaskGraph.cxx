@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/TaskGraph.h"
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+
+#include "AtomicOps.h"
+#include "Discardable.h"
+
+#include <vector>
+
+namespace ZThread {
+
+  namespace {
+
+    const size_t NONE = static_cast<size_t>(-1);
+
+    //! A node, with everything a run needs allocated up front
+    struct Vertex {
+
+      Task task;
+
+      //! Stage that runs this node, submitted when it becomes ready
+      Task stage;
+
+      std::vector<size_t> successors;
+      size_t predecessors;
+
+      //! Predecessors not yet completed in the current run
+      volatile size_t remaining;
+
+      //! Set when a predecessor failed or was skipped in the current run
+      volatile bool skip;
+
+      //! Successors released by this node, kept to avoid allocating in a run
+      std::vector<Task> ready;
+
+      Vertex(const Task& t, const Task& s) 
+        : task(t), stage(s), predecessors(0), remaining(0), skip(false) { }
+
+    };
+
+    class GraphImpl;
+
+    //! Runs a node of a graph
+    class Stage : public Runnable, public Discardable {
+
+      GraphImpl* _impl;
+      size_t _index;
+
+    public:
+
+      Stage(GraphImpl* impl, size_t index) : _impl(impl), _index(index) { }
+
+      void run();
+
+      void discard();
+
+    };
+
+    class GraphImpl {
+
+      typedef std::vector<Vertex*> VertexList;
+
+      VertexList _vertices;
+
+      //! Nodes without predecessors, rebuilt after the graph changes
+      std::vector<Task> _roots;
+      bool _changed;
+
+      PoolExecutor* _executor;
+
+      //! Nodes not yet completed in the current run
+      volatile size_t _outstanding;
+
+      volatile bool _canceled;
+      volatile bool _failed;
+
+      FastMutex _lock;
+      Condition _done;
+      bool _running;
+
+      //! Is there a path from one node to another?
+      bool reaches(size_t from, size_t to) {
+
+        std::vector<bool> seen(_vertices.size(), false);
+        std::vector<size_t> pending(1, from);
+
+        while(!pending.empty()) {
+
+          size_t i = pending.back();
+          pending.pop_back();
+
+          if(i == to)
+            return true;
+
+          if(seen[i])
+            continue;
+
+          seen[i] = true;
+
+          const std::vector<size_t>& next = _vertices[i]->successors;
+          pending.insert(pending.end(), next.begin(), next.end());
+
+        }
+
+        return false;
+
+      }
+
+      //! Submit the ready successors, falling back to the calling thread
+      void submit(std::vector<Task>& ready) {
+
+        try {
+
+          _executor->executeBatch(&ready[0], ready.size());
+
+        } catch(Synchronization_Exception&) {
+
+          // The executor was canceled during the run; the remaining nodes 
+          // are completed here, skipped, so that the run still finishes 
+          AtomicOps::exchange(_canceled, true);
+
+          for(std::vector<Task>::iterator i = ready.begin(); i != ready.end(); ++i)
+            (*i)->run();
+
+        }
+
+      }
+
+      //! Mark a node as complete; the last one ends the run
+      void finish() {
+
+        if(AtomicOps::decrement(_outstanding) != 0)
+          return;
+
+        Guard<FastMutex> g(_lock);
+
+        _running = false;
+        _done.broadcast();
+
+      }
+
+    public:
+
+      GraphImpl() 
+        : _changed(false), _executor(0), _outstanding(0), _canceled(false), 
+          _failed(false), _done(_lock), _running(false) { }
+
+      ~GraphImpl() {
+
+        for(VertexList::iterator i = _vertices.begin(); i != _vertices.end(); ++i)
+          delete *i;
+
+      }
+
+      size_t add(const Task& task) {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_running)
+          throw InvalidOp_Exception();
+
+        Vertex* v = new Vertex(task, Task(new Stage(this, _vertices.size())));
+
+        try {
+          _vertices.push_back(v);
+        } catch(...) {
+          delete v;
+          throw;
+        }
+
+        _changed = true;
+        return _vertices.size() - 1;
+
+      }
+
+      void depends(size_t node, size_t predecessor) {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_running || node >= _vertices.size() || predecessor >= _vertices.size())
+          throw InvalidOp_Exception();
+
+        if(reaches(node, predecessor))
+          throw InvalidOp_Exception();
+
+        Vertex& p = *_vertices[predecessor];
+        Vertex& v = *_vertices[node];
+
+        p.successors.push_back(node);
+        p.ready.reserve(p.successors.size());
+        ++v.predecessors;
+
+        _changed = true;
+
+      }
+
+      void execute(PoolExecutor& executor) {
+
+        Guard<FastMutex> g(_lock);
+
+        if(_running)
+          throw InvalidOp_Exception();
+
+        if(_vertices.empty())
+          return;
+
+        if(_changed) {
+
+          _roots.clear();
+
+          for(VertexList::iterator i = _vertices.begin(); i != _vertices.end(); ++i)
+            if((*i)->predecessors == 0)
+              _roots.push_back((*i)->stage);
+
+          _changed = false;
+
+        }
+
+        for(VertexList::iterator i = _vertices.begin(); i != _vertices.end(); ++i) {
+
+          (*i)->remaining = (*i)->predecessors;
+          (*i)->skip = false;
+
+        }
+
+        _executor = &executor;
+        _outstanding = _vertices.size();
+        _canceled = false;
+        _failed = false;
+
+        // Publishes the reset above before any node can run
+        AtomicOps::fence();
+
+        _running = true;
+
+        try {
+
+          executor.executeBatch(&_roots[0], _roots.size());
+
+        } catch(...) {
+
+          _running = false;
+          throw;
+
+        }
+
+      }
+
+      //! Run a node, then each successor it alone releases, on this thread
+      void run(size_t index) {
+
+        while(index != NONE) {
+
+          Vertex& v = *_vertices[index];
+
+          bool skip = AtomicOps::load(v.skip);
+
+          if(!skip && !AtomicOps::load(_canceled)) {
+
+            try {
+
+              v.task->run();
+
+            } catch(...) {
+
+              AtomicOps::exchange(_failed, true);
+              skip = true;
+
+            }
+
+          }
+
+          index = NONE;
+          v.ready.clear();
+
+          for(std::vector<size_t>::iterator i = v.successors.begin(); i != v.successors.end(); ++i) {
+
+            Vertex& s = *_vertices[*i];
+
+            if(skip)
+              AtomicOps::exchange(s.skip, true);
+
+            if(AtomicOps::decrement(s.remaining) != 0)
+              continue;
+
+            if(index == NONE)
+              index = *i;
+            else
+              v.ready.push_back(s.stage);
+
+          }
+
+          if(!v.ready.empty())
+            submit(v.ready);
+
+          finish();
+
+        }
+
+      }
+
+      bool wait(unsigned long timeout, bool timed) {
+
+        Guard<FastMutex> g(_lock);
+
+        while(_running) {
+
+          if(!timed)
+            _done.wait();
+          else if(!_done.wait(timeout))
+            return false;
+
+        }
+
+        if(AtomicOps::exchange(_failed, false))
+          throw Synchronization_Exception("A node of the graph threw an exception");
+
+        return true;
+
+      }
+
+      //! A node was dropped by the executor; the rest of the run is skipped
+      void discard(size_t index) {
+
+        AtomicOps::exchange(_canceled, true);
+        run(index);
+
+      }
+
+      void cancel() {
+        AtomicOps::exchange(_canceled, true);
+      }
+
+      bool isCanceled() {
+        return AtomicOps::load(_canceled);
+      }
+
+      size_t size() {
+
+        Guard<FastMutex> g(_lock);
+        return _vertices.size();
+
+      }
+
+    };
+
+    void Stage::run() {
+      _impl->run(_index);
+    }
+
+    void Stage::discard() {
+      _impl->discard(_index);
+    }
+
+  }
+
+  TaskGraph::TaskGraph() : _impl(new GraphImpl) { }
+
+  TaskGraph::~TaskGraph() {
+
+    try {
+      _impl->wait(0, false);
+    } catch(...) { }
+
+  }
+
+  TaskGraph::Node TaskGraph::add(const Task& task) {
+    return _impl->add(task);
+  }
+
+  void TaskGraph::depends(Node node, Node predecessor) {
+    _impl->depends(node, predecessor);
+  }
+
+  void TaskGraph::execute(PoolExecutor& executor) {
+    _impl->execute(executor);
+  }
+
+  void TaskGraph::run(PoolExecutor& executor) {
+
+    execute(executor);
+    wait();
+
+  }
+
+  void TaskGraph::wait() {
+    _impl->wait(0, false);
+  }
+
+  bool TaskGraph::wait(unsigned long timeout) {
+    return _impl->wait(timeout, true);
+  }
+
+  void TaskGraph::cancel() {
+    _impl->cancel();
+  }
+
+  bool TaskGraph::isCanceled() {
+    return _impl->isCanceled();
+  }
+
+  size_t TaskGraph::size() {
+    return _impl->size();
+  }
+
+} // namespace ZThread
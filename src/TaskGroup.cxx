@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/TaskGroup.h"
+
+#include "AtomicOps.h"
+#include "Clock.h"
+#include "WorkSignal.h"
+
+namespace ZThread {
+
+  namespace {
+
+    class GroupImpl {
+
+      //! Tasks submitted and not yet completed
+      volatile size_t _pending;
+
+      volatile bool _canceled;
+
+      //! Set once a task threw
+      volatile bool _failed;
+
+      //! The executor's signal, also notified when the last pending task completes
+      CountedPtr< WorkSignal > _work;
+
+    public:
+
+      GroupImpl(const CountedPtr< WorkSignal >& work) 
+        : _pending(0), _canceled(false), _failed(false), _work(work) { }
+
+      void add() {
+
+        if(AtomicOps::load(_canceled))
+          throw Cancellation_Exception();
+
+        AtomicOps::increment(_pending);
+
+      }
+
+      void remove() {
+
+        if(AtomicOps::decrement(_pending) == 0)
+          _work->notify();
+
+      }
+
+      bool isDone() {
+        return AtomicOps::load(_pending) == 0;
+      }
+
+      size_t epoch() {
+        return _work->epoch();
+      }
+
+      //! Block until a task is queued or the group is done, or for at most the given time
+      void block(size_t epoch, unsigned long timeout) {
+        _work->wait(epoch, timeout);
+      }
+
+      void fail() {
+        AtomicOps::exchange(_failed, true);
+      }
+
+      //! Report, and clear, a failure
+      bool failed() {
+        return AtomicOps::exchange(_failed, false);
+      }
+
+      void cancel() {
+        AtomicOps::exchange(_canceled, true);
+      }
+
+      bool isCanceled() {
+        return AtomicOps::load(_canceled);
+      }
+
+    };
+
+    //! Run a task as a member of a group
+    class Member : public Runnable {
+
+      CountedPtr< GroupImpl > _impl;
+      Task _task;
+
+    public:
+
+      Member(const CountedPtr< GroupImpl >& impl, const Task& task) 
+        : _impl(impl), _task(task) { }
+
+      void run() {
+
+        try {
+
+          if(!_impl->isCanceled())
+            _task->run();
+
+        } catch(...) {
+          _impl->fail();
+        }
+
+        _impl->remove();
+
+      }
+
+    };
+
+  }
+
+  TaskGroup::TaskGroup(PoolExecutor& executor) 
+    : _executor(executor), _impl(new GroupImpl(executor._work)) { }
+
+  TaskGroup::~TaskGroup() {
+
+    try {
+      wait();
+    } catch(...) { }
+
+  }
+
+  void TaskGroup::run(const Task& task) {
+
+    _impl->add();
+
+    try {
+
+      _executor.execute(new Member(_impl, task));
+
+    } catch(...) {
+
+      _impl->remove();
+      throw;
+
+    }
+
+  }
+
+  void TaskGroup::wait() {
+
+    for(;;) {
+
+      // Read before looking for work, so that a task queued or the group 
+      // completing in the meantime is not missed
+      size_t epoch = _impl->epoch();
+
+      if(_impl->isDone())
+        break;
+
+      // Help with whatever is queued, the group's tasks or others, and
+      // block only when there is nothing to run
+      if(!_executor.runQueued())
+        _impl->block(epoch, 0);
+
+    }
+
+    if(_impl->failed())
+      throw Synchronization_Exception("A task of the group threw an exception");
+
+  }
+
+  bool TaskGroup::wait(unsigned long timeout) {
+
+    unsigned long start = currentTick();
+
+    for(;;) {
+
+      size_t epoch = _impl->epoch();
+
+      if(_impl->isDone())
+        break;
+
+      unsigned long elapsed = currentTick() - start;
+      if(elapsed >= timeout)
+        return false;
+
+      if(!_executor.runQueued())
+        _impl->block(epoch, timeout - elapsed);
+
+    }
+
+    if(_impl->failed())
+      throw Synchronization_Exception("A task of the group threw an exception");
+
+    return true;
+
+  }
+
+  void TaskGroup::cancel() {
+    _impl->cancel();
+  }
+
+  bool TaskGroup::isCanceled() {
+    return _impl->isCanceled();
+  }
+
+} // namespace ZThread
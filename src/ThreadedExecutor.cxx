@@ -21,354 +21,163 @@
  */
 
 #include "zthread/ThreadedExecutor.h"
+#include "zthread/Condition.h"
 #include "zthread/Guard.h"
 #include "zthread/FastMutex.h"
 #include "zthread/Time.h"
 
 #include "ThreadImpl.h"
+#include "WaiterQueue.h"
+
+#include <algorithm>
 
 namespace ZThread {
 
   namespace {
 
-    //! 
-    class WaiterQueue {
-    
-    #ifdef __ghs
-    public:  // A. Scheurer - public access specifier necessary --- integrity compiler complains types below are otherwise inaccessible.
-             // I think this is actually correct, nested types are by default private and not accessible
-             // by an enclosing class state in same namespace. I'm surprises VC6 allows these types to be
-             // non-public.
-             // Compiler Errors...
-             // ThreadedExecutor.cxx", line 48: error: type "ZThread::<unnamed>::WaiterQueue::ThreadList" is inaccessible
-             // "ThreadedExecutor.cxx", line 67: error: type "ZThread::<unnamed>::WaiterQueue::Group" is inaccessible
-             // "ThreadedExecutor.cxx", line 76: error: type "ZThread::<unnamed>::WaiterQueue::Group" is inaccessible
-    #endif
-
-      typedef std::deque<ThreadImpl*>  ThreadList;
-      
-      typedef struct group_t {
-        size_t     id;
-        size_t     count;
-        ThreadList waiters;
-        group_t(size_t n) : id(n), count(0) {}
-        
-        // A. Scheurer
-        // I created this copy constructor because w/o the ThreadedExecutor creates threads which suspend/hang.
-        // This copy constructor is needed for insertion of these objects into _list or std::deque
-        // The compiler supplied copy constructor was causing process to core, 
-        // ThreadList was probably being copied when it shouldn't have, since the List is that of 
-        // ThreadImpl's - having it in 2 containers could cause double deletion.
-        // push_back or insert into the std::deque causes a group object to be copied via this constructor.
-        group_t(const group_t& rhs) { id = rhs.id; count = rhs.count; /* waiters = rhs.waiters; ?? */ }
-      } Group;
-
-      typedef std::deque<Group>  GroupList;
-
-      //! Predicate to find a specific group
-      struct by_id : public std::unary_function<bool, Group> {
-        size_t id;
-        by_id(size_t n) : id(n) {}
-        bool operator()(const Group& grp) {
-          return grp.id == id;
-        }
-      };
-
-      //! Functor to count groups
-      struct counter : public std::unary_function<void, Group> {
-        size_t count;
-        counter() : count(0) {}
-        void operator()(const Group& grp) { count += grp.count; }
-        operator size_t() { return count; }
-      };
-      
-      FastMutex     _lock;
-      GroupList _list;
-      size_t    _id;
-      size_t    _generation;
-
-    public:
-      
-      WaiterQueue() : _id(0), _generation(0) {
-        // At least one empty-group exists
-        _list.push_back(Group(_id++));
-      }
+    typedef std::pair<size_t, size_t> Ticket;
 
-      /**
-       * Insert the current thread into the current waiter list
-       *
-       * @pre  At least one empty group exists
-       * @post At least one empty group exists
-       */
-      bool wait(unsigned long timeout) {
+    //! A worker thread waiting to be handed another task
+    struct Parked {
 
-        ThreadImpl* self = ThreadImpl::current();
-        Monitor& m = self->getMonitor();
+      Condition ready;
 
-        Monitor::STATE state;
+      //! Where the worker keeps its task and ticket
+      Task& task;
+      Ticket& ticket;
 
-        Guard<Lockable> g1(_lock);
+      bool assigned;
 
-        // At least one empty-group exists
-        assert(!_list.empty());
+      Parked(FastMutex& lock, Task& t, Ticket& tk) 
+        : ready(lock), task(t), ticket(tk), assigned(false) { }
 
-        // Return w/o waiting if there are no executing tasks
-        if((size_t)std::for_each(_list.begin(), _list.end(), counter()) < 1)
-          return true;
+    };
 
-        // Update the waiter list for the active group 
-        _list.back().waiters.push_back(self);
-        size_t n = _list.back().id;
+    //! Synchronization point for the Executor 
+    class ExecutorImpl {
 
-        m.acquire();
-        
-        {
-          
-          Guard<Lockable, UnlockedScope> g2(g1);          
-          state = timeout == 0 ? m.wait() : m.wait(timeout);
+      typedef std::deque<ThreadImpl*> ThreadList;
+      typedef std::deque<Parked*> ParkedList;
 
-        }
+      bool _canceled;
+      FastMutex _lock;      
 
-        m.release();
+      //! Worker threads
+      ThreadList _threads;
 
-        // If awoke due to a reason other than the last task in the group 'n' completing,
-        // then then find the group 'self' is waiting in
-        GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-        if(i != _list.end()) {
+      //! Worker threads waiting for a task, most recently parked last
+      ParkedList _parked;
 
-          // Remove 'self' from that list if it is still a member
-          ThreadList::iterator j = std::find(i->waiters.begin(), i->waiters.end(), self);
-          if(j != i->waiters.end())
-            i->waiters.erase(j);
+      //! Time (milliseconds) a finished worker waits to be reused, 0 if never
+      unsigned long _keepAlive;
+      
+      WaiterQueue _queue;
 
-        }
+    public:
 
-        // At least one empty-group exists
-        assert(!_list.empty());
-
-        switch(state) {
-          case Monitor::SIGNALED:
-            break;
-          case Monitor::TIMEDOUT:
-            return false;
-          case Monitor::INTERRUPTED:
-            throw Interrupted_Exception();
-          default:
-            throw Synchronization_Exception();
-        } 
-       
-        return true;
+      ExecutorImpl(unsigned long keepAlive) : _canceled(false), _keepAlive(keepAlive) {}
 
+      WaiterQueue& getWaiterQueue() { 
+        return _queue;
       }
-      
-      /**
-       * Increment the active group count
-       *
-       * @pre at least 1 empty group exists
-       * @post at least 1 non-empty group exists 
-       */
-      std::pair<size_t, size_t> increment() {
-        
-        Guard<FastMutex> g(_lock);
-        
-        // At least one empty-group exists
-        assert(!_list.empty());
 
-        GroupList::iterator i = --_list.end();
-        size_t n = i->id;
+      void registerThread(size_t generation) {
+               
+        // Interrupt slow starting threads
+        if(getWaiterQueue().generation() != generation)
+          ThreadImpl::current()->interrupt();
 
-        if(i == _list.end()) {
+        // Enqueue for possible future interrupt() 
+        else {
 
-          // A group should never have been removed until
-          // the final task in that group completed
-          assert(0);
+          Guard<FastMutex> g(_lock);
+          _threads.push_back( ThreadImpl::current() );
 
         }
 
-        i->count++;
-
-        // When the active group is being incremented, insert a new active group
-        // to replace it if there were waiting threads
-        if(i == --_list.end() && !i->waiters.empty()) 
-          _list.push_back(Group(_id++));
-
-        // At least 1 non-empty group exists
-        assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+      }
 
-        return std::make_pair(n, _generation);
+      void unregisterThread() {
+        
+        Guard<FastMutex> g(_lock);
+        _threads.erase(std::remove(_threads.begin(), _threads.end(), ThreadImpl::current()), _threads.end());
 
       }
-      
 
       /**
-       * Decrease the count for the group with the given id.
+       * Hand a task to a parked worker thread.
        *
-       * @param n group id
-       * 
-       * @pre  At least 1 non-empty group exists
-       * @post At least 1 empty group exists
+       * @return false if no worker was parked.
        */
-      void decrement(size_t n) {
+      bool reuse(const Task& task, const Ticket& ticket) {
 
-        Guard<FastMutex> g1(_lock);
+        Guard<FastMutex> g(_lock);
 
-        // At least 1 non-empty group exists
-        assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+        if(_keepAlive == 0 || _parked.empty())
+          return false;
 
-        // Find the requested group
-        GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-        if(i == _list.end()) {
-          
-          // A group should never have been removed until
-          // the final task in that group completed
-          assert(0);
+        Parked* p = _parked.back();
+        _parked.pop_back();
 
-        }
+        p->task     = task;
+        p->ticket   = ticket;
+        p->assigned = true;
 
-        // Decrease the count for tasks in this group,
-        if(--i->count == 0 && i == _list.begin()) {
-          
-          do { 
-
-            // When the first group completes, wake all waiters for every
-            // group, starting from the first until a group that is not 
-            // complete is reached
-
-            /*
-            // Don't remove the empty active group
-            if(i == --_list.end() && i->waiters.empty())
-              break;
-            */
-            
-            if( awaken(*i) ) {
-            
-              // If all waiters were awakened, remove the group  
-              i = _list.erase(i);
-              
-            } else {
-              
-              {
-
-                // Otherwise, unlock and yield allowing the waiter
-                // lists to be updated if other threads are busy
-                Guard<FastLock, UnlockedScope> g2(g1);
-                ThreadImpl::yield();
-              
-              }
-
-              i = _list.begin();
-
-            }
-              
-          } while(i != _list.end() && i->count == 0); 
-          
-          // Ensure that an active group exists
-          if(_list.empty())
-          {
-              // A. Scheurer - This particular executable statement later caused lockup
-              // I suspect there was failing in copy constructor for Group - see above, new copy constructor.
-              // _list is calling copy constructor and its causing thread to hang or suspend.
-              // The copy constructor for Group through std::queue that the compiler supplies isn't good enough.
-              // There are potential problems w/ sharing that 
-              _list.push_back(Group(++_id));
+        p->ready.signal();
 
-          }
-
-        }
+        return true;
 
-        // At least one group exists
-        assert(!_list.empty());
       }
 
       /**
+       * Park the calling worker thread until it is handed another task.
+       *
+       * @return false if no task was handed over within the keep-alive time,
+       *         in which case the thread should exit.
        */
-      size_t generation(bool next = false) {
+      bool park(Task& task, Ticket& ticket) {
 
-        Guard<FastMutex> g(_lock);
-        return next ? _generation++ : _generation;
+        // Don't keep the last task alive while waiting for the next one
+        task.reset();
 
-      }
-      
-    private:
-      
-      /**
-       * Awaken all the waiters remaining in the given group
-       * 
-       * @return
-       *   - true if all the waiting threads were successfully awakened.
-       *   - false if there were one or more threads that could not be awakened.
-       */
-      bool awaken(Group& grp) {
-
-        // Go through the waiter list in the given group; 
-        for(ThreadList::iterator i = grp.waiters.begin(); i != grp.waiters.end();) {
-          
-          ThreadImpl* impl = *i;
-          Monitor& m = impl->getMonitor();
-          
-          // Try the monitor lock, if it cant be locked skip to the next waiter
-          if(m.tryAcquire()) {
-            
-            // Notify the monitor & remove from the waiter list so time isn't
-            // wasted checking it again.
-            i = grp.waiters.erase(i);
-            
-            // Try to wake the waiter, it doesn't matter if this is successful
-            // or not (only fails when the monitor is already going to stop waiting). 
-            m.notify();
-            m.release();
-            
-          } else ++i;
-          
-        }
-        
-        return grp.waiters.empty();
+        // Clear any interrupt left over from the last task
+        ThreadImpl::current()->isInterrupted();
 
-      }
+        Parked p(_lock, task, ticket);
 
-    };
+        Guard<FastMutex> g(_lock);
 
-    //! Synchronization point for the Executor 
-    class ExecutorImpl {
+        if(_canceled || _keepAlive == 0)
+          return false;
 
-      typedef std::deque<ThreadImpl*> ThreadList;
+        _parked.push_back(&p);
 
-      bool _canceled;
-      FastMutex _lock;      
+        try {
+          p.ready.wait(_keepAlive);
+        } catch(Interrupted_Exception&) { }
 
-      //! Worker threads
-      ThreadList _threads;
-      
-      WaiterQueue _queue;
+        if(!p.assigned) {
 
-    public:
+          _parked.erase(std::remove(_parked.begin(), _parked.end(), &p), _parked.end());
+          return false;
 
-      ExecutorImpl() : _canceled(false) {}
+        }
 
-      WaiterQueue& getWaiterQueue() { 
-        return _queue;
-      }
+        return true;
 
-      void registerThread(size_t generation) {
-               
-        // Interrupt slow starting threads
-        if(getWaiterQueue().generation() != generation)
-          ThreadImpl::current()->interrupt();
+      }
 
-        // Enqueue for possible future interrupt() 
-        else {
+      //! Stop caching threads, letting any parked worker exit
+      void release() {
 
-          Guard<FastMutex> g(_lock);
-          _threads.push_back( ThreadImpl::current() );
+        Guard<FastMutex> g(_lock);
 
-        }
+        _keepAlive = 0;
 
-      }
+        for(ParkedList::iterator i = _parked.begin(); i != _parked.end(); ++i)
+          (*i)->ready.signal();
 
-      void unregisterThread() {
-        
-        Guard<FastMutex> g(_lock);
-        std::remove(_threads.begin(), _threads.end(), ThreadImpl::current() );
+        _parked.clear();
 
       }
 
@@ -377,6 +186,12 @@ namespace ZThread {
         Guard<FastMutex> g(_lock);
         _canceled = true;
 
+        // Parked workers will not be given any more tasks
+        for(ParkedList::iterator i = _parked.begin(); i != _parked.end(); ++i)
+          (*i)->ready.signal();
+
+        _parked.clear();
+
       }
 
       bool isCanceled() {
@@ -410,47 +225,46 @@ namespace ZThread {
       CountedPtr< ExecutorImpl > _impl;
       Task _task;
 
-      size_t _generation;
-      size_t _group;
+      //! Group and generation
+      Ticket _ticket;
 
     public:
 
-      Worker(const CountedPtr< ExecutorImpl >& impl, const Task& task)
-        : _impl(impl), _task(task) {
-
-        std::pair<size_t, size_t> pr( _impl->getWaiterQueue().increment() );
-    
-        _group      = pr.first;
-        _generation = pr.second;
-
-      }
+      Worker(const CountedPtr< ExecutorImpl >& impl, const Task& task, const Ticket& ticket)
+        : _impl(impl), _task(task), _ticket(ticket) { }
 
       size_t group() const {
-        return _group;
+        return _ticket.first;
       }
 
       size_t generation() const {
-        return _generation;
+        return _ticket.second;
       }
       
       void run() {
+
+        // Run tasks until no other task is handed to this thread before
+        // its keep-alive time expires
+        do {
         
-        // Register this thread once its begun; the generation is used to ensure
-        // threads that are slow starting are properly interrupted
+          // Register this thread once its begun; the generation is used to ensure
+          // threads that are slow starting are properly interrupted
 
-        _impl->registerThread( generation() );
+          _impl->registerThread( generation() );
         
-        try {
-          _task->run();          
-        } catch(...) {
-          /* consume the exceptions the work propogates */
-        }
+          try {
+            _task->run();          
+          } catch(...) {
+            /* consume the exceptions the work propogates */
+          }
         
-        _impl->getWaiterQueue().decrement( group() );
+          _impl->getWaiterQueue().decrement( group() );
+
+          // Unregister this thread
 
-        // Unregister this thread
+          _impl->unregisterThread();
 
-        _impl->unregisterThread();
+        } while(_impl->park(_task, _ticket));
 
       }
 
@@ -458,13 +272,34 @@ namespace ZThread {
 
   }
 
-  ThreadedExecutor::ThreadedExecutor() : _impl(new ExecutorImpl) {}
+  ThreadedExecutor::ThreadedExecutor() : _impl(new ExecutorImpl(0)) {}
 
-  ThreadedExecutor::~ThreadedExecutor() {}
+  ThreadedExecutor::ThreadedExecutor(unsigned long keepAlive) : _impl(new ExecutorImpl(keepAlive)) {}
+
+  ThreadedExecutor::~ThreadedExecutor() {
+
+    // Let cached threads exit rather than wait out their keep-alive time
+    _impl->release();
+
+  }
   
   void ThreadedExecutor::execute(const Task& task) {
-     
-    Thread t( new Worker(_impl, task) );
+
+    Ticket ticket( _impl->getWaiterQueue().increment() );
+
+    if(_impl->reuse(task, ticket))
+      return;
+
+    try {
+
+      Thread t( new Worker(_impl, task, ticket) );
+
+    } catch(...) {
+
+      _impl->getWaiterQueue().decrement(ticket.first);
+      throw;
+
+    }
 
   }  
 
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTOKENIMPL_H__
+#define __ZTTOKENIMPL_H__
+
+#include "zthread/Guard.h"
+#include "AtomicOps.h"
+#include "FastLock.h"
+#include "ThreadImpl.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ZThread {
+
+  /**
+   * @class TokenImpl
+   * @version 2.3.3
+   *
+   * State shared by the copies of a CancellationToken: the canceled flag, and 
+   * the threads currently running a task submitted with the token.
+   */
+  class TokenImpl {
+
+    typedef std::vector<ThreadImpl*> ThreadList;
+
+    volatile bool _canceled;
+
+    //! Serialize access to the list of threads
+    FastLock _lock;
+
+    //! Threads running a task bound to this token
+    ThreadList _threads;
+
+  public:
+
+    TokenImpl() : _canceled(false) { }
+
+    bool isCanceled() {
+      return AtomicOps::load(_canceled);
+    }
+
+    /**
+     * Register the calling thread as running a task bound to this token, so
+     * that cancel() will interrupt it.
+     *
+     * @return false if the token has been canceled, and the task should not run
+     */
+    bool enter() {
+
+      if(isCanceled())
+        return false;
+
+      Guard<FastLock> g(_lock);
+
+      // cancel() sets the flag before taking the lock
+      if(isCanceled())
+        return false;
+
+      _threads.push_back(ThreadImpl::current());
+      return true;
+
+    }
+
+    /**
+     * Unregister the calling thread. Once this returns the thread will no 
+     * longer be interrupted by cancel().
+     */
+    void leave() {
+
+      Guard<FastLock> g(_lock);
+
+      ThreadList::iterator i = std::find(_threads.begin(), _threads.end(), ThreadImpl::current());
+      if(i != _threads.end())
+        _threads.erase(i);
+
+    }
+
+    void cancel() {
+
+      if(AtomicOps::exchange(_canceled, true))
+        return;
+
+      Guard<FastLock> g(_lock);
+
+      for(ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+        (*i)->interrupt();
+
+    }
+
+  }; /* TokenImpl */
+
+} // namespace ZThread
+
+#endif // __ZTTOKENIMPL_H__
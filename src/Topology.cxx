@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "Topology.h"
+#include "zthread/Singleton.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#if defined(HAVE_UNISTD_H)
+#  include <unistd.h>
+#endif
+
+#if defined(HAVE_SCHED_GETCPU)
+#  include <sched.h>
+#endif
+
+namespace ZThread {
+
+  namespace {
+
+    //! Read the first line of a file
+    bool readLine(const char* path, std::string& line) {
+
+      FILE* f = std::fopen(path, "r");
+      if(!f)
+        return false;
+
+      char buf[4096];
+      bool ok = std::fgets(buf, sizeof(buf), f) != 0;
+
+      std::fclose(f);
+
+      if(ok)
+        line = buf;
+
+      return ok;
+
+    }
+
+    //! Parse a list of processors such as "0-3,8-11"
+    void parseList(const std::string& s, std::vector<size_t>& list) {
+
+      const char* p = s.c_str();
+
+      while(*p) {
+
+        char* end;
+        unsigned long first = std::strtoul(p, &end, 10);
+
+        if(end == p)
+          break;
+
+        unsigned long last = first;
+        p = end;
+
+        if(*p == '-') {
+
+          last = std::strtoul(p + 1, &end, 10);
+          p = end;
+
+        }
+
+        for(unsigned long i = first; i <= last; ++i)
+          list.push_back(i);
+
+        if(*p != ',')
+          break;
+
+        ++p;
+
+      }
+
+    }
+
+    //! Parse a row of distances such as "10 21"
+    void parseDistances(const std::string& s, std::vector<size_t>& list) {
+
+      const char* p = s.c_str();
+
+      for(;;) {
+
+        char* end;
+        unsigned long d = std::strtoul(p, &end, 10);
+
+        if(end == p)
+          break;
+
+        list.push_back(d);
+        p = end;
+
+      }
+
+    }
+
+    //! Order nodes by distance, breaking ties by number
+    struct ByDistance {
+
+      const std::vector<size_t>& distance;
+
+      ByDistance(const std::vector<size_t>& d) : distance(d) { }
+
+      bool operator()(size_t a, size_t b) const {
+        return distance[a] < distance[b] || (distance[a] == distance[b] && a < b);
+      }
+
+    };
+
+  }
+
+  Topology::Topology() {
+
+    std::vector<List> distances;
+
+#if defined(__linux__)
+
+    std::string line;
+    List ids, kept;
+
+    if(readLine("/sys/devices/system/node/online", line))
+      parseList(line, ids);
+
+    for(size_t i = 0; i < ids.size(); ++i) {
+
+      char path[128];
+      std::sprintf(path, "/sys/devices/system/node/node%lu/cpulist", (unsigned long)ids[i]);
+
+      // Skip memory-only nodes
+      List cpus;
+      if(readLine(path, line))
+        parseList(line, cpus);
+
+      if(cpus.empty())
+        continue;
+
+      // One distance for each online node, in the order they are listed
+      List row;
+      std::sprintf(path, "/sys/devices/system/node/node%lu/distance", (unsigned long)ids[i]);
+
+      if(readLine(path, line))
+        parseDistances(line, row);
+
+      _cpus.push_back(cpus);
+      distances.push_back(row);
+      kept.push_back(i);
+
+    }
+
+    // Keep only the distances to nodes with processors
+    for(size_t i = 0; i < distances.size(); ++i) {
+
+      List d;
+      for(size_t j = 0; j < kept.size(); ++j)
+        d.push_back(kept[j] < distances[i].size() ? distances[i][kept[j]] : 0);
+
+      distances[i].swap(d);
+
+    }
+
+#endif
+
+    // Fall back on a single node holding every online processor
+    if(_cpus.empty()) {
+
+      long n = 1;
+
+#if defined(_SC_NPROCESSORS_ONLN)
+      n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+      List cpus;
+      for(long i = 0; i < (n > 0 ? n : 1); ++i)
+        cpus.push_back(i);
+
+      _cpus.push_back(cpus);
+      distances.assign(1, List(1, 10));
+
+    }
+
+    for(size_t i = 0; i < _cpus.size(); ++i) {
+
+      List order;
+      for(size_t j = 0; j < _cpus.size(); ++j)
+        order.push_back(j);
+
+      // The node itself is always nearest, nodes of unknown distance farthest
+      List d(distances[i]);
+      d.resize(_cpus.size(), (size_t)-1);
+      d[i] = 0;
+
+      std::sort(order.begin(), order.end(), ByDistance(d));
+      _nearest.push_back(order);
+
+      for(List::const_iterator c = _cpus[i].begin(); c != _cpus[i].end(); ++c) {
+
+        if(*c >= _nodeOf.size())
+          _nodeOf.resize(*c + 1, 0);
+
+        _nodeOf[*c] = i;
+        _all.push_back(*c);
+
+      }
+
+    }
+
+    std::sort(_all.begin(), _all.end());
+
+  }
+
+  const Topology& Topology::instance() {
+    return *Singleton<Topology>::instance();
+  }
+
+  size_t Topology::currentNode() const {
+
+#if defined(HAVE_SCHED_GETCPU)
+
+    int cpu = sched_getcpu();
+    if(cpu >= 0 && (size_t)cpu < _nodeOf.size())
+      return _nodeOf[cpu];
+
+#endif
+
+    return 0;
+
+  }
+
+} // namespace ZThread
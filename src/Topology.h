@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTOPOLOGY_H__
+#define __ZTTOPOLOGY_H__
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <vector>
+#include <cstddef>
+
+namespace ZThread {
+
+  /**
+   * @class Topology
+   * @version 2.3.3
+   *
+   * Describes how the processors of the system are grouped into NUMA nodes. 
+   * On Linux the topology is read from <em>/sys/devices/system/node</em>, 
+   * including the distance between nodes. Elsewhere, or when that information
+   * is not available, every processor belongs to a single node.
+   */
+  class Topology {
+
+    typedef std::vector<size_t> List;
+
+    //! Processors of each node
+    std::vector<List> _cpus;
+
+    //! Nodes ordered from nearest to farthest, for each node
+    std::vector<List> _nearest;
+
+    //! Node of each processor
+    List _nodeOf;
+
+    //! Every processor
+    List _all;
+
+  public:
+
+    //! Discover the topology of the system
+    Topology();
+
+    //! Topology of the system, discovered once
+    static const Topology& instance();
+
+    //! Number of nodes
+    size_t nodes() const {
+      return _cpus.size();
+    }
+
+    //! Processors belonging to a node
+    const List& cpus(size_t node) const {
+      return _cpus[node];
+    }
+
+    //! Every processor
+    const List& cpus() const {
+      return _all;
+    }
+
+    //! All nodes, starting with the given node and ordered by distance from it
+    const List& nearest(size_t node) const {
+      return _nearest[node];
+    }
+
+    //! Node of the processor running the calling thread, 0 if unknown
+    size_t currentNode() const;
+
+  }; /* Topology */
+
+} // namespace ZThread
+
+#endif // __ZTTOPOLOGY_H__
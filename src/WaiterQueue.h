@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTWAITERQUEUE_H__
+#define __ZTWAITERQUEUE_H__
+
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/Time.h"
+#include "AtomicOps.h"
+
+#include <utility>
+
+namespace ZThread {
+
+  /**
+   * @class WaiterQueue
+   * @version 2.3.3
+   *
+   * Tracks the tasks an executor has in flight so that threads can wait() 
+   * for every task submitted before they began waiting.
+   *
+   * Tasks are counted in one of two epochs. A task is counted in the current 
+   * epoch when it is submitted, and uncounted when it completes; both are a
+   * single atomic operation. A waiter closes the current epoch, so tasks 
+   * submitted later are counted in the next one, and waits for the epoch it 
+   * closed to drain. An epoch can only be closed once the epoch before it 
+   * has drained, which is what allows two counters to be reused forever.
+   *
+   * The lock is only used by waiters, and by the task that drains an epoch
+   * while some thread is waiting. 
+   */
+  class WaiterQueue {
+
+    //! Serializes waiters
+    FastMutex _lock;
+
+    //! Signaled when an epoch drains while there are waiters
+    Condition _drained;
+
+    //! Tasks in flight, for each epoch
+    volatile size_t _counts[2];
+
+    //! Current epoch, only changed while holding the lock
+    volatile size_t _epoch;
+
+    //! Number of threads waiting, or about to wait
+    volatile size_t _waiters;
+
+    //! Interrupt generation
+    volatile size_t _generation;
+
+    //! Count of the tasks in flight for an epoch
+    size_t count(size_t epoch) const {
+      return AtomicOps::load(_counts[epoch & 1]);
+    }
+
+    //! Test whether an epoch has drained, given the current epoch
+    bool drained(size_t epoch) const {
+      return _epoch - epoch > 1 || count(epoch) == 0;
+    }
+
+    /**
+     * Wait for an epoch to drain, or until the deadline passes.
+     *
+     * @return false if the deadline passed.
+     */
+    bool await(size_t epoch, unsigned long timeout, const Time& start) {
+
+      while(!drained(epoch)) {
+
+        if(timeout == 0) {
+
+          _drained.wait();
+          continue;
+
+        }
+
+        Time now;
+        now -= start;
+
+        unsigned long elapsed = now.seconds() * 1000 + now.milliseconds();
+        if(elapsed >= timeout || !_drained.wait(timeout - elapsed))
+          return drained(epoch);
+
+      }
+
+      return true;
+
+    }
+
+  public:
+
+    WaiterQueue() : _drained(_lock), _epoch(0), _waiters(0), _generation(0) {
+
+      _counts[0] = 0;
+      _counts[1] = 0;
+
+    }
+
+    /**
+     * Block the calling thread until all tasks submitted before this invocation
+     * have completed.
+     *
+     * @param timeout maximum amount of time (milliseconds) to wait, 0 to wait 
+     *        without a timeout
+     *
+     * @return false if the timeout expired.
+     *
+     * @exception Interrupted_Exception thrown if the calling thread is interrupted.
+     */
+    bool wait(unsigned long timeout) {
+
+      Time start;
+
+      // Announce the waiter before looking at the counts, so a task that drains 
+      // an epoch either sees the waiter or has already been seen to complete
+      AtomicOps::increment(_waiters);
+
+      try {
+
+        Guard<FastMutex> g(_lock);
+
+        size_t epoch = _epoch;
+
+        // Return w/o waiting if there are no executing tasks
+        bool result = count(epoch) == 0 && count(epoch + 1) == 0;
+
+        // Close the current epoch once the one before it has drained
+        if(!result && (result = await(epoch - 1, timeout, start))) {
+
+          if(_epoch == epoch)
+            AtomicOps::store(_epoch, epoch + 1);
+
+          result = await(epoch, timeout, start);
+
+        }
+
+        AtomicOps::decrement(_waiters);
+        return result;
+
+      } catch(...) {
+
+        AtomicOps::decrement(_waiters);
+        throw;
+
+      }
+
+    }
+    
+    /**
+     * Count tasks that are being submitted in the current epoch.
+     *
+     * @param n number of tasks
+     *
+     * @return the epoch and the interrupt generation for the tasks
+     */
+    std::pair<size_t, size_t> increment(size_t n = 1) {
+      
+      size_t epoch = AtomicOps::load(_epoch);
+      AtomicOps::fetchAndAdd(_counts[epoch & 1], n);
+
+      return std::make_pair(epoch, AtomicOps::load(_generation));
+
+    }
+
+    /**
+     * Uncount completed tasks.
+     *
+     * @param epoch epoch returned by increment()
+     * @param n number of tasks
+     */
+    void decrement(size_t epoch, size_t n = 1) {
+
+      if(AtomicOps::fetchAndAdd(_counts[epoch & 1], 0 - n) != n || AtomicOps::load(_waiters) == 0)
+        return;
+
+      Guard<FastMutex> g(_lock);
+      _drained.broadcast();
+
+    }
+
+    /**
+     * Get the interrupt generation.
+     *
+     * @param next advance to the next generation, returning the current one
+     */
+    size_t generation(bool next = false) {
+      return next ? AtomicOps::fetchAndAdd(_generation, 1) : AtomicOps::load(_generation);
+    }
+
+  }; /* WaiterQueue */
+
+} // namespace ZThread
+
+#endif // __ZTWAITERQUEUE_H__
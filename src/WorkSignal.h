@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTWORKSIGNAL_H__
+#define __ZTWORKSIGNAL_H__
+
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/NonCopyable.h"
+#include "AtomicOps.h"
+
+namespace ZThread {
+
+  /**
+   * @class WorkSignal
+   * @version 2.3.3
+   *
+   * Wakes threads that help a PoolExecutor while they wait for something, 
+   * such as a TaskGroup, when a task is queued or when what they wait for 
+   * completes. Each notification advances an epoch; a thread reads the epoch
+   * before it looks for work, and wait() returns at once if it has moved, so
+   * no notification is missed. notify() only takes the lock while a thread 
+   * is blocked.
+   */
+  class WorkSignal : private NonCopyable {
+
+    //! Serialize blocking threads
+    FastMutex _lock;
+
+    //! Signaled on each notification while a thread is blocked
+    Condition _changed;
+
+    //! Notifications so far
+    volatile size_t _epoch;
+
+    //! Number of threads blocked, or about to block, in wait()
+    volatile size_t _waiters;
+
+  public:
+
+    WorkSignal() : _changed(_lock), _epoch(0), _waiters(0) { }
+
+    //! Current epoch, read before looking for work
+    size_t epoch() {
+      return AtomicOps::load(_epoch);
+    }
+
+    //! Advance the epoch, waking any blocked thread
+    void notify() {
+
+      AtomicOps::increment(_epoch);
+
+      if(AtomicOps::load(_waiters) > 0) {
+
+        Guard<FastMutex> g(_lock);
+        _changed.broadcast();
+
+      }
+
+    }
+
+    /**
+     * Block until the epoch moves past the given one.
+     *
+     * @param epoch epoch read before looking for work
+     * @param timeout longest time, in milliseconds, to block for; 0 for no limit
+     *
+     * @exception Interrupted_Exception thrown if the calling thread is interrupted
+     */
+    void wait(size_t epoch, unsigned long timeout) {
+
+      Guard<FastMutex> g(_lock);
+
+      // Announce the intent to block before checking the epoch, notify() 
+      // checks for waiters after advancing it
+      AtomicOps::increment(_waiters);
+
+      try {
+
+        if(AtomicOps::load(_epoch) == epoch) {
+
+          if(timeout == 0)
+            _changed.wait();
+          else
+            _changed.wait(timeout);
+
+        }
+
+      } catch(...) {
+
+        AtomicOps::decrement(_waiters);
+        throw;
+
+      }
+
+      AtomicOps::decrement(_waiters);
+
+    }
+
+  }; /* WorkSignal */
+
+} // namespace ZThread
+
+#endif // __ZTWORKSIGNAL_H__
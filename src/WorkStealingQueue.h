@@ -0,0 +1,666 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTWORKSTEALINGQUEUE_H__
+#define __ZTWORKSTEALINGQUEUE_H__
+
+#include "zthread/Condition.h"
+#include "zthread/FastMutex.h"
+#include "zthread/Guard.h"
+#include "zthread/Queue.h"
+
+#include "AtomicOps.h"
+#include "FastLock.h"
+#include "TSS.h"
+
+#include <deque>
+#include <iterator>
+#include <vector>
+
+namespace ZThread {
+
+  /**
+   * @class WorkStealingQueue
+   * @version 2.3.3
+   *
+   * A WorkStealingQueue is a Queue implementation that spreads its items over 
+   * a set of per-thread deques instead of serializing every operation on a 
+   * single lock.
+   *
+   * - Threads attach()ed to the queue own a deque. Items they add() are pushed
+   *   onto the back of that deque, and next() pops from the back first (LIFO) 
+   *   to keep recently produced work close to the cache that produced it.
+   *
+   * - Items added by threads that are not attached go to a shared injection 
+   *   queue, which is served in FIFO order.
+   *
+   * - A thread that finds its own deque and the injection queue empty steals
+   *   from the front of another thread's deque before it blocks.
+   *
+   * Threads blocked by next() are parked on a Condition and are only signaled 
+   * when some thread is known to be parked, so add() does not touch a shared
+   * lock while every consumer is busy.
+   *
+   * @see Queue
+   */
+  template <class T>
+    class WorkStealingQueue : public Queue<T> {
+
+      //! Deque owned by a single attached thread
+      struct Slot {
+
+        //! Serialize the owner with thieves
+        FastLock lock;
+
+        //! Items owned by the slot
+        std::deque<T> items;
+
+        //! Lock free hint of the number of items
+        volatile size_t count;
+
+        //! Queue the slot belongs to
+        WorkStealingQueue* owner;
+
+        //! Position of the slot in the slot list
+        size_t index;
+
+        //! Number of items taken by the owner, used to poll the injection queue
+        size_t ticks;
+
+        //! Set while a thread owns the slot
+        bool attached;
+
+        //! Keep neighboring slots off the same cache line
+        char pad[64];
+
+        Slot(WorkStealingQueue* q, size_t n) 
+          : count(0), owner(q), index(n), ticks(0), attached(false) {}
+
+      };
+
+      typedef std::vector<Slot*> SlotList;
+      typedef std::deque<SlotList*> RetiredList;
+
+      //! Slot bound to the calling thread
+      static TSS<Slot*> _current;
+
+      //! Serialize attach() and detach()
+      FastLock _slotLock;
+
+      //! Current slot list, replaced (never modified) as it grows
+      SlotList* volatile _slots;
+
+      //! Slot lists that have been replaced, reclaimed on destruction
+      RetiredList _retired;
+
+      //! Serialize access to the injection queue
+      FastLock _injectLock;
+
+      //! Items added by threads that are not attached
+      std::deque<T> _inject;
+
+      //! Lock free hint of the number of injected items
+      volatile size_t _injected;
+
+      //! Serialize parking threads
+      FastMutex _idleLock;
+
+      //! Signaled when an item is added and a thread is parked
+      Condition _idle;
+
+      //! Number of items added but not yet taken
+      volatile size_t _pending;
+
+      //! Number of threads parked, or about to park, in next()
+      volatile size_t _sleepers;
+
+      //! Cancellation flag
+      volatile bool _canceled;
+
+      //! Round robin starting point for threads that are not attached
+      volatile size_t _victim;
+
+      public:
+
+      //! Create a new WorkStealingQueue
+      WorkStealingQueue() 
+        : _slots(new SlotList), _injected(0), _idle(_idleLock), 
+          _pending(0), _sleepers(0), _canceled(false), _victim(0) {}
+
+      //! Destroy a WorkStealingQueue, delete remaining items
+      virtual ~WorkStealingQueue() { 
+
+        for(typename SlotList::iterator i = _slots->begin(); i != _slots->end(); ++i)
+          delete *i;
+
+        delete _slots;
+
+        for(typename RetiredList::iterator i = _retired.begin(); i != _retired.end(); ++i)
+          delete *i;
+
+      }
+
+      /**
+       * Give the calling thread its own deque. Items the thread add()s will
+       * be kept in that deque until the thread takes them back with next(),
+       * or until they are stolen by some other thread.
+       *
+       * @post The calling thread is attached to this queue.
+       */
+      void attach() {
+
+        Guard<FastLock> g(_slotLock);
+
+        SlotList* list = _slots;
+        Slot* slot = 0;
+
+        // Reuse the slot of a thread that has detached
+        for(typename SlotList::iterator i = list->begin(); i != list->end(); ++i)
+          if(!(*i)->attached) {
+            slot = *i;
+            break;
+          }
+
+        // Otherwise publish a larger copy of the slot list; the old list is 
+        // kept until destruction since thieves may still be walking it
+        if(slot == 0) {
+
+          slot = new Slot(this, list->size());
+
+          SlotList* grown = new SlotList(*list);
+          grown->push_back(slot);
+
+          _retired.push_back(list);
+          AtomicOps::store(_slots, grown);
+
+        }
+
+        slot->attached = true;
+        _current.set(slot);
+
+      }
+
+      /**
+       * Release the deque owned by the calling thread. Any items left in it 
+       * are moved to the injection queue.
+       *
+       * @post The calling thread is no longer attached to this queue.
+       */
+      void detach() {
+
+        Slot* slot = _current.get();
+        if(slot == 0 || slot->owner != this)
+          return;
+
+        _current.set(0);
+
+        {
+
+          Guard<FastLock> g1(slot->lock);
+          Guard<FastLock> g2(_injectLock);
+
+          while(!slot->items.empty()) {
+
+            _inject.push_back(slot->items.front());
+            slot->items.pop_front();
+
+          }
+
+          AtomicOps::store(_injected, _inject.size());
+          AtomicOps::store(slot->count, (size_t)0);
+
+        }
+
+        Guard<FastLock> g(_slotLock);
+        slot->attached = false;
+
+      }
+
+      /**
+       * Add a value to this Queue. 
+       *
+       * @param item value to be added to the Queue
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       *
+       * @pre  The Queue should not have been canceled prior to the invocation of this function.
+       * @post If no exception is thrown, a copy of <i>item</i> will have been added to the Queue.
+       *
+       * @see Queue::add(const T& item)
+       */
+      virtual void add(const T& item) {
+
+        // Account for the item before it becomes visible; a canceled queue 
+        // will not stop draining while this count is non-zero
+        AtomicOps::increment(_pending);
+
+        if(AtomicOps::load(_canceled)) {
+
+          AtomicOps::decrement(_pending);
+          throw Cancellation_Exception();
+
+        }
+
+        Slot* slot = _current.get();
+
+        try {
+
+          if(slot != 0 && slot->owner == this) {
+
+            Guard<FastLock> g(slot->lock);
+
+            slot->items.push_back(item);
+            AtomicOps::store(slot->count, slot->items.size());
+
+          } else {
+
+            Guard<FastLock> g(_injectLock);
+
+            _inject.push_back(item);
+            AtomicOps::store(_injected, _inject.size());
+
+          }
+
+        } catch(...) {
+
+          AtomicOps::decrement(_pending);
+          throw;
+
+        }
+
+        // Only wake a thread if one has parked
+        if(AtomicOps::load(_sleepers) > 0) {
+
+          Guard<FastMutex> g(_idleLock);
+          _idle.signal();
+
+        }
+
+      }
+
+      /**
+       * Add a value to this Queue. 
+       *
+       * @param item value to be added to the Queue
+       * @param timeout unused, adding to a WorkStealingQueue never blocks
+       *
+       * @return <em>true</em> 
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       *
+       * @see Queue::add(const T& item, unsigned long timeout)
+       */
+      virtual bool add(const T& item, unsigned long) {
+
+        add(item);
+        return true;
+
+      }
+
+      /**
+       * Add a range of values to this Queue, taking the lock for the calling 
+       * thread's deque (or for the injection queue) once, and waking at most
+       * one parked thread for each value added.
+       *
+       * @param begin first value to be added to the Queue
+       * @param end position after the last value to be added
+       *
+       * @exception Cancellation_Exception thrown if this Queue has been canceled.
+       */
+      template <class InputIterator>
+      void addAll(InputIterator begin, InputIterator end) {
+
+        size_t n = std::distance(begin, end);
+        if(n == 0)
+          return;
+
+        AtomicOps::fetchAndAdd(_pending, n);
+
+        if(AtomicOps::load(_canceled)) {
+
+          AtomicOps::fetchAndAdd(_pending, 0 - n);
+          throw Cancellation_Exception();
+
+        }
+
+        Slot* slot = _current.get();
+
+        try {
+
+          if(slot != 0 && slot->owner == this) {
+
+            Guard<FastLock> g(slot->lock);
+
+            slot->items.insert(slot->items.end(), begin, end);
+            AtomicOps::store(slot->count, slot->items.size());
+
+          } else {
+
+            Guard<FastLock> g(_injectLock);
+
+            _inject.insert(_inject.end(), begin, end);
+            AtomicOps::store(_injected, _inject.size());
+
+          }
+
+        } catch(...) {
+
+          AtomicOps::fetchAndAdd(_pending, 0 - n);
+          throw;
+
+        }
+
+        size_t sleepers = AtomicOps::load(_sleepers);
+        if(sleepers > 0) {
+
+          Guard<FastMutex> g(_idleLock);
+
+          for(size_t i = 0; i < n && i < sleepers; ++i)
+            _idle.signal();
+
+        }
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue. The calling thread's own 
+       * deque is checked first, then the injection queue and then the deques
+       * of other threads.
+       *
+       * If invoked when there are no values present to return then the calling thread 
+       * will be blocked until a value arrives in the Queue.
+       *
+       * @return <em>T</em> next available value
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled
+       *            and no values remain.
+       * @exception Interrupted_Exception thrown if the thread was interrupted while waiting
+       *            to retrieve a value
+       *
+       * @post The value returned will have been removed from the Queue.
+       */
+      virtual T next() {
+
+        T item;
+
+        while(!take(item))
+          park(0);
+
+        return item;
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue.
+       *
+       * @param timeout maximum amount of time (milliseconds) this method may block
+       *        the calling thread.
+       *
+       * @return <em>T</em> next available value
+       * 
+       * @exception Cancellation_Exception thrown if this Queue has been canceled
+       *            and no values remain.
+       * @exception Timeout_Exception thrown if the timeout expires before a value
+       *            can be retrieved.
+       *
+       * @post The value returned will have been removed from the Queue.
+       */
+      virtual T next(unsigned long timeout) {
+
+        T item;
+
+        while(!take(item))
+          if(!park(timeout == 0 ? 1 : timeout))
+            throw Timeout_Exception();
+
+        return item;
+
+      }
+
+      /**
+       * Retrieve and remove a value from this Queue, if one is available, 
+       * without blocking.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryNext(T& item) {
+        return take(item);
+      }
+
+      /**
+       * Retrieve and remove one of the values that have been queued longest, 
+       * if one is available, without blocking. Deques keep no order between 
+       * each other, so this is the front of the injection queue or else the 
+       * front of some thread's deque, never the value its owner added last.
+       *
+       * @param item receives the value
+       * @return <em>true</em> if a value was retrieved.
+       */
+      bool tryOldest(T& item) {
+
+        if(!popInjected(item) && !steal(0, item))
+          return false;
+
+        AtomicOps::decrement(_pending);
+        return true;
+
+      }
+
+      /**
+       * Cancel this queue. 
+       * 
+       * @post Any threads blocked by a next() function will throw a Cancellation_Exception
+       *       once no values remain.
+       * 
+       * @see Queue::cancel()
+       */
+      virtual void cancel() {
+
+        AtomicOps::exchange(_canceled, true);
+
+        Guard<FastMutex> g(_idleLock);
+        _idle.broadcast();
+
+      }
+
+      /**
+       * @see Queue::isCanceled()
+       */
+      virtual bool isCanceled() {
+        return AtomicOps::load(_canceled);
+      }
+
+      /**
+       * @see Queue::size()
+       */
+      virtual size_t size() {
+        return AtomicOps::load(_pending);
+      }
+
+      /**
+       * @see Queue::size(unsigned long timeout)
+       */
+      virtual size_t size(unsigned long) {
+        return size();
+      }
+
+      private:
+
+      //! Try each source of work once, without blocking
+      bool take(T& item) {
+
+        Slot* self = _current.get();
+        if(self != 0 && self->owner != this)
+          self = 0;
+
+        bool found = false;
+
+        if(self != 0) {
+
+          // Poll the injection queue now and then so that local work can't
+          // starve tasks submitted from the outside
+          if(++self->ticks % 61 == 0)
+            found = popInjected(item);
+
+          if(!found)
+            found = popBack(self, item);
+
+        }
+
+        if(!found)
+          found = popInjected(item) || steal(self, item);
+
+        if(found)
+          AtomicOps::decrement(_pending);
+
+        return found;
+
+      }
+
+      bool popBack(Slot* slot, T& item) {
+
+        if(AtomicOps::load(slot->count) == 0)
+          return false;
+
+        Guard<FastLock> g(slot->lock);
+
+        if(slot->items.empty())
+          return false;
+
+        item = slot->items.back();
+        slot->items.pop_back();
+
+        AtomicOps::store(slot->count, slot->items.size());
+        return true;
+
+      }
+
+      bool popFront(Slot* slot, T& item) {
+
+        if(AtomicOps::load(slot->count) == 0)
+          return false;
+
+        Guard<FastLock> g(slot->lock);
+
+        if(slot->items.empty())
+          return false;
+
+        item = slot->items.front();
+        slot->items.pop_front();
+
+        AtomicOps::store(slot->count, slot->items.size());
+        return true;
+
+      }
+
+      bool popInjected(T& item) {
+
+        if(AtomicOps::load(_injected) == 0)
+          return false;
+
+        Guard<FastLock> g(_injectLock);
+
+        if(_inject.empty())
+          return false;
+
+        item = _inject.front();
+        _inject.pop_front();
+
+        AtomicOps::store(_injected, _inject.size());
+        return true;
+
+      }
+
+      //! Take the oldest item from some other thread's deque
+      bool steal(Slot* self, T& item) {
+
+        SlotList* list = AtomicOps::load(_slots);
+
+        size_t n = list->size();
+        if(n == 0)
+          return false;
+
+        size_t start = self ? self->index + 1 : AtomicOps::fetchAndAdd(_victim, 1);
+
+        for(size_t i = 0; i < n; ++i) {
+
+          Slot* victim = (*list)[(start + i) % n];
+
+          if(victim != self && popFront(victim, item))
+            return true;
+
+        }
+
+        return false;
+
+      }
+
+      /**
+       * Block until an item is added, or until the queue is canceled.
+       *
+       * @return false if the timeout expired.
+       */
+      bool park(unsigned long timeout) {
+
+        Guard<FastMutex> g(_idleLock);
+
+        // Announce the intent to park before checking for work, add() checks
+        // for sleepers after announcing its item
+        AtomicOps::increment(_sleepers);
+
+        bool signaled = true;
+
+        try {
+
+          if(AtomicOps::load(_pending) == 0) {
+
+            if(AtomicOps::load(_canceled))
+              throw Cancellation_Exception();
+
+            if(timeout == 0)
+              _idle.wait();
+            else
+              signaled = _idle.wait(timeout);
+
+          }
+
+        } catch(...) {
+
+          AtomicOps::decrement(_sleepers);
+          throw;
+
+        }
+
+        AtomicOps::decrement(_sleepers);
+        return signaled;
+
+      }
+
+    }; /* WorkStealingQueue */
+
+  template <class T>
+    TSS<typename WorkStealingQueue<T>::Slot*> WorkStealingQueue<T>::_current;
+
+} // namespace ZThread
+
+#endif // __ZTWORKSTEALINGQUEUE_H__
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTATOMICCOUNTIMPL_H__
+#define __ZTATOMICCOUNTIMPL_H__
+
+#include "../AtomicOps.h"
+
+#include <assert.h>
+
+namespace ZThread {
+
+// The count is kept in the pointer sized slot itself, so creating an
+// AtomicCount (and so every CountedPtr) costs no extra allocation. Only
+// the size_t member of the slot is ever used, and it must fit.
+
+typedef char count_fits_in_slot[sizeof(size_t) <= sizeof(void*) ? 1 : -1];
+
+AtomicCount::AtomicCount(size_t count) {
+
+  AtomicOps::store(_count, count);
+
+}
+
+AtomicCount::~AtomicCount() {
+
+  assert(AtomicOps::load(_count) == 0);
+
+}
+  
+//! Postfix decrement and return the current value
+size_t AtomicCount::operator--(int) {
+  return AtomicOps::fetchAndAdd(_count, -1);
+}
+  
+//! Postfix increment and return the current value
+size_t AtomicCount::operator++(int) {
+  return AtomicOps::fetchAndAdd(_count, 1);
+}
+
+//! Prefix decrement and return the current value
+size_t AtomicCount::operator--() {
+  return AtomicOps::decrement(_count);
+}
+  
+//! Prefix increment and return the current value
+size_t AtomicCount::operator++() {
+  return AtomicOps::increment(_count);
+}
+
+};
+
+#endif // __ZTATOMICCOUNTIMPL_H__
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFASTLOCK_H__
+#define __ZTFASTLOCK_H__
+
+#include "zthread/NonCopyable.h"
+#include "../AtomicOps.h"
+#include "../ThreadOps.h"
+#include <assert.h>
+
+namespace ZThread {
+
+/**
+ * @class FastLock
+ * @version 2.3.3
+ *
+ * This implementation of a FastLock is a ticket lock built on the compiler's
+ * atomic builtins. Each caller draws a ticket and spins until it is served, 
+ * so the lock is granted in FIFO order. A waiter backs off in proportion to 
+ * the number of tickets ahead of it, reading the lock only once per round, 
+ * and yields its processor once it has spun for a short while, since the 
+ * thread holding the lock or next in line may have been preempted.
+ */ 
+class FastLock : private NonCopyable {
+
+  //! Pauses per ticket ahead, and pauses spent in total before a waiter starts yielding
+  enum { BACKOFF = 32, PATIENCE = 1024 };
+
+  //! Next ticket to be drawn
+  volatile unsigned int _next;
+
+  //! Ticket currently being served
+  volatile unsigned int _serving;
+
+public:
+  
+  inline FastLock() : _next(0), _serving(0) { }
+  
+  inline ~FastLock() {
+    assert(_next == _serving);
+  }
+  
+  inline void acquire() {
+
+    unsigned int ticket = AtomicOps::fetchAndAdd(_next, 1u);
+    
+    for(unsigned int spent = 0;;) {
+
+      // Unsigned distance, so ticket numbers can wrap
+      unsigned int ahead = ticket - AtomicOps::load(_serving);
+      if(ahead == 0)
+        break;
+
+      if(spent < PATIENCE) {
+
+        for(unsigned int n = ahead * BACKOFF; n > 0; --n)
+          AtomicOps::pause();
+
+        spent += ahead * BACKOFF;
+
+      } else
+        ThreadOps::yield();
+
+    }
+
+  }
+
+  inline void release() {
+
+    // Only the holder changes _serving
+    AtomicOps::store(_serving, _serving + 1);
+
+  }
+  
+  /**
+   * Acquire the lock only if it is free and nobody is queued for it. This 
+   * function returns immediately regardless of the value of the timeout.
+   *
+   * @param timeout Unused
+   * @return bool
+   */
+  inline bool tryAcquire(unsigned long timeout=0) {
+    
+    unsigned int serving = AtomicOps::load(_serving);
+    return AtomicOps::cas(_next, serving, serving + 1);
+    
+  }
+  
+}; /* FastLock */
+
+
+} // namespace ZThread
+
+#endif
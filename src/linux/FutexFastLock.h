@@ -23,95 +23,52 @@
 #ifndef __ZTFASTLOCK_H__
 #define __ZTFASTLOCK_H__
 
-#include "zthread/NonCopyable.h"
-#include "../ThreadOps.h"
+#include "FutexLock.h"
 #include <assert.h>
-#include <asm/atomic.h>
-
-#if !defined(NDEBUG)
-#  include <pthread.h>
-#endif
 
 namespace ZThread {
 
 /**
  * @class FastLock
+ * @version 2.3.3
  *
- * @author Eric Crahen <http://www.code-foo.com>
- * @date <2003-07-16T23:27:03-0400>
- * @version 2.2.0
- *
- * This implementation of a FastLock uses the atomic operations that
- * linux provides with its kernel sources. This demonstrates how to implement
- * a spinlock with a decrement and test primative.
+ * This implementation of a FastLock sits directly on a linux futex. An 
+ * uncontended acquire() or release() is a single atomic operation, and the
+ * kernel is only entered when threads actually have to wait. 
  */ 
 class FastLock : private NonCopyable {
-  
-  atomic_t _value;
-  
-#if !defined(NDEBUG)
-  pthread_t _owner;
-#endif
 
-public:
-  
-  inline FastLock() {
-  
-    atomic_t tmp =  ATOMIC_INIT(1);
-    _value = tmp;
+  FutexLock _lock;
 
-  }
-  
-  inline ~FastLock() {
+ public:
 
-    assert(atomic_read(&_value) == 1);
-    assert(_owner == 0);
+  inline FastLock() { }
 
+  inline ~FastLock() {
+    assert(!_lock.isHeld());
   }
-  
-  inline void acquire() {
-
-    while(!atomic_dec_and_test(&_value)) {
 
-      atomic_inc(&_value);
-      ThreadOps::yield();
+  inline void acquire() {
+    _lock.acquire();
+  }
 
-    }
-        
-#if !defined(NDEBUG)
-    _owner = pthread_self();
-#endif
+  /**
+   * Try to acquire an exclusive lock, waiting no longer than the given
+   * timeout for it.
+   *
+   * @param timeout milliseconds to wait, 0 to return immediately
+   * @return bool
+   */
+  inline bool tryAcquire(unsigned long timeout=0) {
+    return _lock.acquire(timeout);
   }
 
   inline void release() {
-    
-#if !defined(NDEBUG)
-    assert(pthread_equal(_owner, pthread_self()) != 0);
-#endif
-
-    atomic_inc(&_value);
-    _owner = 0;
-
+    _lock.release();
   }
-  
-  inline bool tryAcquire(unsigned long timeout=0) {
-    
-    bool wasLocked = atomic_dec_and_test(&_value);
-    if(!wasLocked)
-      atomic_inc(&_value);
-
-#if !defined(NDEBUG)
-    if(wasLocked)
-      _owner = pthread_self();
-#endif
 
-    return wasLocked;
-    
-  }
-  
 }; /* FastLock */
 
-
 } // namespace ZThread
 
 #endif
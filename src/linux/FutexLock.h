@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTEXLOCK_H__
+#define __ZTFUTEXLOCK_H__
+
+#include "zthread/NonCopyable.h"
+#include "../AdaptiveSpin.h"
+#include "../AtomicOps.h"
+#include "../Clock.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if !defined(FUTEX_PRIVATE_FLAG)
+#  define FUTEX_PRIVATE_FLAG 0
+#endif
+
+namespace ZThread {
+
+/**
+ * @class FutexLock
+ * @version 2.3.3
+ *
+ * An exclusive lock on a single 32 bit word that only enters the kernel
+ * when it is contended. The word is 0 when the lock is free, 1 when it is
+ * held and 2 when it is held and other threads may be sleeping on it, so
+ * acquiring a free lock is a single compare and swap and releasing a lock 
+ * nobody waits for is a single exchange.
+ *
+ * No ownership or state checks are performed.
+ */
+class FutexLock : private NonCopyable {
+
+  enum { FREE = 0, HELD = 1, CONTENDED = 2 };
+
+  //! Lock word, also the address threads sleep on
+  volatile int _word;
+
+  //! Decides how long to spin before sleeping
+  AdaptiveSpin _spin;
+
+  static inline void sleep(volatile int& word, int value, const struct timespec* timeout) {
+    syscall(SYS_futex, &word, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, value, timeout, 0, 0);
+  }
+
+  static inline void wake(volatile int& word, int count) {
+    syscall(SYS_futex, &word, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, 0, 0, 0);
+  }
+
+ public:
+
+  inline FutexLock() : _word(FREE) { }
+
+  //! Acquire the lock if it is free, without blocking
+  inline bool tryAcquire() {
+    return AtomicOps::cas(_word, (int)FREE, (int)HELD);
+  }
+
+  //! Acquire the lock, sleeping in the kernel while it is held by another thread
+  inline void acquire() {
+
+    if(!tryAcquire())
+      wait();
+
+  }
+
+  /**
+   * Acquire the lock, sleeping in the kernel for no longer than the given
+   * number of milliseconds while it is held by another thread.
+   *
+   * @return bool true if the lock was acquired
+   */
+  inline bool acquire(unsigned long timeout) {
+
+    if(tryAcquire())
+      return true;
+
+    return timeout != 0 && wait(timeout);
+
+  }
+
+  //! Release the lock, waking one sleeping thread if there might be any
+  inline void release() {
+
+    if(AtomicOps::exchange(_word, (int)FREE) == CONTENDED)
+      wake(_word, 1);
+
+  }
+
+  /**
+   * Block until the lock is acquired, spinning first in case the holder is
+   * about to release it. Once a thread has slept on the word it always leaves
+   * it marked contended, which can cost one spurious wake up but never a lost 
+   * one.
+   */
+  void wait() {
+
+    if(_spin.spin(_word, (int)FREE) && tryAcquire())
+      return;
+
+    while(AtomicOps::exchange(_word, (int)CONTENDED) != FREE)
+      sleep(_word, CONTENDED, 0);
+
+  }
+
+  /**
+   * Block until the lock is acquired or until the timeout expires.
+   *
+   * @return bool true if the lock was acquired
+   */
+  bool wait(unsigned long timeout) {
+
+    if(_spin.spin(_word, (int)FREE) && tryAcquire())
+      return true;
+
+    unsigned long long deadline = Clock::microseconds() + (unsigned long long)timeout * 1000;
+
+    while(AtomicOps::exchange(_word, (int)CONTENDED) != FREE) {
+
+      unsigned long long now = Clock::microseconds();
+      if(now >= deadline)
+        return false;
+
+      struct timespec remaining;
+      remaining.tv_sec  = (deadline - now) / 1000000;
+      remaining.tv_nsec = ((deadline - now) % 1000000) * 1000;
+
+      sleep(_word, CONTENDED, &remaining);
+
+    }
+
+    return true;
+
+  }
+
+  //! Test if the lock is currently held, without acquiring it
+  inline bool isHeld() const {
+    return AtomicOps::load(_word) != FREE;
+  }
+
+}; /* FutexLock */
+
+} // namespace ZThread
+
+#endif // __ZTFUTEXLOCK_H__
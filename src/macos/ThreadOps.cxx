@@ -74,6 +74,10 @@ bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) {
   return true;
 }
 
+bool ThreadOps::setAffinity(const std::vector<size_t>&) {
+  return false;
+}
+
 
 bool ThreadOps::spawn(Runnable* task) {
 
@@ -26,6 +26,7 @@
 #include "zthread/Priority.h"
 
 #include <assert.h>
+#include <vector>
 #include <CoreServices/CoreServices.h>
 //#include <Multiprocessing.h>
 //#include <MultiprocessingInfo.h>
@@ -145,6 +146,15 @@ public:
    */
   static bool getPriority(ThreadOps*, Priority&);
 
+  /**
+   * Bind the current native thread to a set of processors, if supported 
+   * by the system.
+   *
+   * @param cpus processors the thread may run on
+   * @return bool false if unsuccessful
+   */
+  static bool setAffinity(const std::vector<size_t>& cpus);
+
 protected:
 
   /**
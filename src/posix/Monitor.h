@@ -26,6 +26,8 @@
 #include "../Status.h"
 #include "../FastLock.h"
 
+#include <pthread.h>
+
 namespace ZThread {
 
 /**
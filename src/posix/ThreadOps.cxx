@@ -25,7 +25,7 @@
 #include "zthread/Runnable.h"
 #include <errno.h>
 
-#if defined(HAVE_SCHED_YIELD)
+#if defined(HAVE_SCHED_YIELD) || defined(HAVE_SCHED_SETAFFINITY)
 #  include <sched.h>
 #endif
 
@@ -121,6 +121,28 @@ bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) {
 
 }
 
+bool ThreadOps::setAffinity(const std::vector<size_t>& cpus) {
+
+  bool result = false;
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  for(std::vector<size_t>::const_iterator i = cpus.begin(); i != cpus.end(); ++i)
+    if(*i < CPU_SETSIZE)
+      CPU_SET(*i, &set);
+
+  // A pid of 0 binds the calling thread
+  result = !cpus.empty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+
+#endif
+
+  return result;
+
+}
+
 
 bool ThreadOps::spawn(Runnable* task) {
   return pthread_create(&_tid, 0, _dispatch, task) == 0;
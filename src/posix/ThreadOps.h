@@ -27,6 +27,7 @@
 #include "zthread/Priority.h"
 #include <pthread.h>
 #include <assert.h>
+#include <vector>
 
 namespace ZThread {
 
@@ -133,6 +134,15 @@ public:
    */
   static bool getPriority(ThreadOps*, Priority&);
 
+  /**
+   * Bind the current native thread to a set of processors, if supported 
+   * by the system.
+   *
+   * @param cpus processors the thread may run on
+   * @return bool false if unsuccessful
+   */
+  static bool setAffinity(const std::vector<size_t>& cpus);
+
 protected:
 
   /**
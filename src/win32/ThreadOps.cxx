@@ -161,6 +161,18 @@ bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) {
 
 }
 
+bool ThreadOps::setAffinity(const std::vector<size_t>& cpus) {
+
+  DWORD_PTR mask = 0;
+
+  for(std::vector<size_t>::const_iterator i = cpus.begin(); i != cpus.end(); ++i)
+    if(*i < sizeof(mask) * 8)
+      mask |= ((DWORD_PTR)1) << *i;
+
+  return mask != 0 && ::SetThreadAffinityMask(::GetCurrentThread(), mask) != 0;
+
+}
+
 
 bool ThreadOps::spawn(Runnable* task) {
 
@@ -26,6 +26,7 @@
 #include "zthread/Priority.h"
 #include <windows.h>
 #include <assert.h>
+#include <vector>
 
 namespace ZThread {
 
@@ -130,6 +131,15 @@ class ThreadOps {
    */
   static bool getPriority(ThreadOps*, Priority&);
 
+  /**
+   * Bind the current native thread to a set of processors, if supported 
+   * by the system.
+   *
+   * @param cpus processors the thread may run on
+   * @return bool false if unsuccessful
+   */
+  static bool setAffinity(const std::vector<size_t>& cpus);
+
 protected:
 
   /**